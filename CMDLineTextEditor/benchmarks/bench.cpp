@@ -0,0 +1,528 @@
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+
+#include "../src/Components/Timestamp.h"
+#include "../src/Components/Logging.h"
+#include "../src/Components/Workspace.h"
+#include "../src/DirWalker.h"
+#include "../src/DirTreeCache.h"
+#include "../src/TextSearch.h"
+#include "../src/Regex.h"
+#include "../src/TrigramIndex.h"
+#include "../src/FileSearch.h"
+
+void BenchTimestamp();
+void BenchLogPolicy();
+void BenchParallelLoad();
+void BenchDirWalk();
+void BenchTextSearch();
+void BenchRegex();
+void BenchTrigramSearch();
+void BenchGrep();
+void BenchDiff();
+
+// keeps the optimizer from dropping the measured work
+volatile size_t g_Sink = 0;
+
+// workspaces of the benchmarks journal here instead of into the journal of the application
+const std::string g_JournalPath = (std::filesystem::temp_directory_path() / "bench_edit_journal").string();
+
+template<typename F>
+double MeasureNanoseconds(int iterations, F&& f) {
+    const auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        f(i);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+int main() {
+    std::cout << "  ######## Starting benchmarks ########" << std::endl << std::endl;
+    // workspaces write their state and logs below data/, which must not be the one of the application,
+    // so every benchmark runs in a scratch directory
+    const auto previousDir = std::filesystem::current_path();
+    const auto benchDir = std::filesystem::temp_directory_path() / "editor_benchmarks";
+    std::filesystem::create_directories(benchDir);
+    std::filesystem::current_path(benchDir);
+
+    BenchTimestamp();
+    BenchLogPolicy();
+    BenchParallelLoad();
+    BenchDirWalk();
+    BenchTextSearch();
+    BenchRegex();
+    BenchTrigramSearch();
+    BenchGrep();
+    BenchDiff();
+
+    std::filesystem::remove(g_JournalPath);
+    std::filesystem::current_path(previousDir);
+    std::filesystem::remove_all(benchDir);
+    std::cout << " ######## All benchmarks finished! ########" << std::endl << std::endl;
+}
+
+void BenchTimestamp() {
+    std::cout << "======== Benchmarking Timestamp ========" << std::endl;
+    constexpr int iterations = 1000000;
+    const auto start = std::chrono::system_clock::now();
+    // one log record every 100us, like a replay session
+    const auto at = [&start](int i) { return start + std::chrono::microseconds(100 * i); };
+
+    const double legacy = MeasureNanoseconds(iterations, [&](int i) {
+        const auto timeTick = std::chrono::system_clock::to_time_t(at(i));
+        const std::tm tm = *std::localtime(&timeTick);
+        std::stringstream ss;
+        ss << std::put_time(&tm, "%Y%m%d %H:%M:%S");
+        g_Sink = g_Sink + ss.str().size();
+    });
+    std::cout << "localtime + stringstream: " << legacy << " ns/call" << std::endl;
+
+    const double cached = MeasureNanoseconds(iterations, [&](int i) {
+        char text[TimestampLength];
+        FormatTimestamp(at(i), text);
+        g_Sink = g_Sink + static_cast<size_t>(text[16]);
+    });
+    std::cout << "FormatTimestamp: " << cached << " ns/call" << std::endl;
+
+    const double wrapped = MeasureNanoseconds(iterations, [&](int i) {
+        g_Sink = g_Sink + GetTimestamp(at(i)).size();
+    });
+    std::cout << "GetTimestamp: " << wrapped << " ns/call" << std::endl;
+    std::cout << "speedup: " << legacy / cached << "x" << std::endl;
+
+    std::cout << "======== End of Timestamp Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchLogPolicy() {
+    std::cout << "======== Benchmarking Log Policies ========" << std::endl;
+    constexpr int iterations = 200000;
+    // a bulk-edit session: mostly `show`, some edits
+    const Command show("show 1:20");
+    const Command append("append \"some new line\"");
+
+    for (const auto* spec : {"all", "mutating", "sample:100", "counters:60"}) {
+        LogPolicy policy;
+        LogPolicy::Parse(spec, policy);
+        LogSink sink;
+        sink.SetGroupSize(4096);
+        sink.SetRotationPolicy(LogRotationPolicy{0, std::chrono::hours(0), 0, 0});
+        double perCommand;
+        {
+            Logger logger(".bench.log", sink);
+            logger.SetPolicy(policy);
+            perCommand = MeasureNanoseconds(iterations, [&](int i) {
+                logger.Log(i % 10 == 0 ? append : show);
+            });
+        }
+        std::cout << spec << ": " << perCommand << " ns/command, "
+            << std::filesystem::file_size(".bench.log") << " bytes logged" << std::endl;
+        std::filesystem::remove(".bench.log");
+    }
+
+    std::cout << "======== End of Log Policy Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchParallelLoad() {
+    std::cout << "======== Benchmarking Parallel Load ========" << std::endl;
+    constexpr int fileCount = 64;
+    constexpr int lineCount = 20000;
+    constexpr int repeats = 5;
+    const std::string dir = ".bench-files";
+    std::filesystem::create_directories(dir);
+    nlohmann::json state;
+    state["log_mode"] = 2;
+    state["current_editor"] = 0;
+    for (int i = 0; i < fileCount; i++) {
+        const auto path = dir + "/file" + std::to_string(i);
+        std::ofstream out(path);
+        for (int line = 0; line < lineCount; line++) {
+            out << "line " << line << " of a restored file with some text to split into lines\n";
+        }
+        state["editors"].push_back({{"path", path}, {"log_mode", 2}, {"modified", false}});
+    }
+    const auto stateText = state.dump();
+    std::string loadLine = "load";
+    for (int i = 0; i < fileCount; i++) {
+        loadLine += ' ' + dir + "/file" + std::to_string(i);
+    }
+
+    // a restored workspace only registers its editors, `load` naming them all reads them at once
+    double singleThreaded = 0;
+    for (size_t threads : {1, 2, 4, 8, 16}) {
+        // an editor loads once, so every repeat restores a fresh workspace
+        double perRestore = 0;
+        for (int r = 0; r < repeats; r++) {
+            // restoring and loading print every editor, which is not what is measured
+            auto* console = std::cout.rdbuf(nullptr);
+            Workspace workspace(stateText, g_JournalPath);
+            workspace.SetThreadCount(threads);
+            perRestore += MeasureNanoseconds(1, [&](int) {
+                workspace.Handle(Command(loadLine));
+            }) / 1e6 / repeats;
+            std::cout.rdbuf(console);
+        }
+        if (threads == 1) {
+            singleThreaded = perRestore;
+        }
+        std::cout << threads << " thread(s): " << perRestore << " ms to load " << fileCount << " restored files, speedup: "
+            << singleThreaded / perRestore << "x" << std::endl;
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << "======== End of Parallel Load Benchmark ========" << std::endl << std::endl;
+}
+
+// the traversal dir-tree used before DirWalker
+size_t CountEntriesRecursively(const std::filesystem::path& dir) {
+    std::vector<std::filesystem::directory_entry> entries;
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        entries.push_back(entry);
+    }
+    size_t count = entries.size();
+    for (const auto& entry : entries) {
+        if (std::filesystem::is_directory(entry.path())) {
+            count += CountEntriesRecursively(entry.path());
+        }
+    }
+    return count;
+}
+
+size_t CountEntries(const DirNode& node) {
+    size_t count = node.children.size();
+    for (const auto& child : node.children) {
+        count += CountEntries(child);
+    }
+    return count;
+}
+
+void BenchDirWalk() {
+    std::cout << "======== Benchmarking Directory Walk ========" << std::endl;
+    const std::string root = ".bench-tree";
+    for (int i = 0; i < 20; i++) {
+        for (int j = 0; j < 20; j++) {
+            const auto dir = root + "/d" + std::to_string(i) + "/s" + std::to_string(j);
+            std::filesystem::create_directories(dir);
+            for (int k = 0; k < 25; k++) {
+                std::ofstream(dir + "/f" + std::to_string(k));
+            }
+        }
+    }
+
+    size_t entries = 0;
+    const double legacy = MeasureNanoseconds(5, [&](int) {
+        entries = CountEntriesRecursively(root);
+    }) / 1e6;
+    std::cout << "directory_iterator + is_directory: " << legacy << " ms for " << entries << " entries" << std::endl;
+    for (size_t threads : {1, 4, 16}) {
+        const DirWalker walker(threads);
+        const double walked = MeasureNanoseconds(5, [&](int) {
+            entries = CountEntries(walker.Walk(root));
+        }) / 1e6;
+        std::cout << "DirWalker, " << threads << " thread(s): " << walked << " ms for " << entries
+            << " entries, speedup: " << legacy / walked << "x" << std::endl;
+    }
+    // what `du` plus a tree listing cost before --summary
+    uint64_t bytes = 0;
+    const double legacySizes = MeasureNanoseconds(5, [&](int) {
+        bytes = 0;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+            bytes += entry.is_regular_file() ? entry.file_size() : 0;
+        }
+    }) / 1e6 + legacy;
+    std::cout << "directory walk + recursive_directory_iterator sizes: " << legacySizes << " ms" << std::endl;
+    DirWalkOptions sized;
+    sized.readSizes = true;
+    const double walkedSizes = MeasureNanoseconds(5, [&](int) {
+        g_Sink = g_Sink + DirWalker(4).Walk(root, sized).children.size();
+    }) / 1e6;
+    std::cout << "DirWalker with sizes, 4 thread(s): " << walkedSizes << " ms, speedup: "
+        << legacySizes / walkedSizes << "x" << std::endl;
+    for (const bool useInotify : {true, false}) {
+        DirTreeCache cache(4, useInotify);
+        cache.Get(root);
+        const double cached = MeasureNanoseconds(5, [&](int i) {
+            // one changed directory per call, as between two `dir-tree` of a working session
+            std::ofstream(root + "/d" + std::to_string(i) + (useInotify ? "/new" : "/polled"));
+            entries = CountEntries(cache.Get(root));
+        }) / 1e6;
+        std::cout << "DirTreeCache, " << (useInotify ? "inotify" : "polling") << ": " << cached << " ms for "
+            << entries << " entries, speedup: " << legacy / cached << "x" << std::endl;
+    }
+    std::filesystem::remove_all(root);
+
+    std::cout << "======== End of Directory Walk Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchTextSearch() {
+    std::cout << "======== Benchmarking Text Search ========" << std::endl;
+    // source-like lines, with the needle's first and last bytes common and the needle itself rare
+    std::vector<std::string> lines;
+    size_t bytes = 0;
+    for (int i = 0; bytes < (256u << 20); i++) {
+        lines.push_back("    const auto value" + std::to_string(i) + " = compute(index, offset) + table[index % size];");
+        if (i % 100000 == 0) {
+            lines.back() += " // TODO: needle";
+        }
+        bytes += lines.back().size();
+    }
+    const auto throughput = [bytes](double nanoseconds) { return static_cast<double>(bytes) / nanoseconds; };
+
+    // a needle starting with a rare byte suits memchr, one starting with a common byte does not
+    for (const std::string needle : {"TODO: needle", "offset) * table"}) {
+        size_t hits = 0;
+        const double legacy = MeasureNanoseconds(3, [&](int) {
+            hits = 0;
+            for (const auto& line : lines) {
+                for (auto at = line.find(needle); at != std::string::npos; at = line.find(needle, at + needle.size())) {
+                    hits++;
+                }
+            }
+        });
+        std::cout << '"' << needle << "\", std::string::find: " << throughput(legacy) << " GB/s, " << hits << " hits" << std::endl;
+        const SubstringSearcher searcher(needle);
+        const double searched = MeasureNanoseconds(3, [&](int) {
+            hits = ForEachHit(lines, 0, lines.size() - 1, searcher, [](const TextHit&) { return true; });
+        });
+        std::cout << '"' << needle << "\", SubstringSearcher: " << throughput(searched) << " GB/s, " << hits
+            << " hits, speedup: " << legacy / searched << "x" << std::endl;
+    }
+
+    std::cout << "======== End of Text Search Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchRegex() {
+    std::cout << "======== Benchmarking Regex ========" << std::endl;
+    std::vector<std::string> lines;
+    size_t bytes = 0;
+    for (int i = 0; bytes < (16u << 20); i++) {
+        lines.push_back("    const auto value" + std::to_string(i) + " = compute(index, offset) + table[index % size];");
+        if (i % 1000 == 0) {
+            lines.back() += " // TODO(owner" + std::to_string(i % 7) + "): fix";
+        }
+        bytes += lines.back().size();
+    }
+    const auto throughput = [bytes](double nanoseconds) { return static_cast<double>(bytes) / nanoseconds * 1e3; };
+
+    for (const std::string pattern : {"TODO\\(\\w+\\)", "value[0-9]+7 =", "(index|offset) % [a-z]+"}) {
+        size_t hits = 0;
+        const double legacy = MeasureNanoseconds(1, [&](int) {
+            const std::regex regex(pattern);
+            hits = 0;
+            for (const auto& line : lines) {
+                for (auto it = std::sregex_iterator(line.begin(), line.end(), regex); it != std::sregex_iterator(); ++it) {
+                    hits++;
+                }
+            }
+        });
+        std::cout << '"' << pattern << "\", std::regex: " << throughput(legacy) << " MB/s, " << hits << " hits" << std::endl;
+        RegexCache cache;
+        const double searched = MeasureNanoseconds(3, [&](int) {
+            hits = ForEachRegexHit(lines, 0, lines.size() - 1, *cache.Get(pattern), [](const TextHit&) { return true; });
+        });
+        std::cout << '"' << pattern << "\", Regex: " << throughput(searched) << " MB/s, " << hits
+            << " hits, speedup: " << legacy / searched << "x" << std::endl;
+    }
+    // what the cache saves a script running the same `find-re` again
+    RegexCache cache;
+    const double compiled = MeasureNanoseconds(1000, [&](int i) {
+        g_Sink = g_Sink + Regex("(index|offset" + std::to_string(i) + ") % [a-z]+").GetGroupCount();
+    });
+    const double cached = MeasureNanoseconds(1000, [&](int) {
+        g_Sink = g_Sink + cache.Get("(index|offset) % [a-z]+")->GetGroupCount();
+    });
+    std::cout << "compiling: " << compiled << " ns, cached: " << cached << " ns" << std::endl;
+
+    // the same refactor over many open files, one `replace-re` per editor against `replace-all`
+    constexpr int fileCount = 32;
+    const std::string dir = ".bench-replace";
+    std::filesystem::create_directories(dir);
+    std::string loadLine = "load";
+    for (int i = 0; i < fileCount; i++) {
+        loadLine += ' ' + dir + "/file" + std::to_string(i);
+    }
+    for (const size_t threads : {0, 1, 4}) {
+        for (int i = 0; i < fileCount; i++) {
+            std::ofstream out(dir + "/file" + std::to_string(i));
+            for (size_t line = 0; line < lines.size() / fileCount; line++) {
+                out << lines[line] << '\n';
+            }
+        }
+        auto* console = std::cout.rdbuf(nullptr);
+        Workspace workspace("", g_JournalPath);
+        workspace.SetThreadCount(std::max<size_t>(threads, 1));
+        workspace.Handle(Command(loadLine));
+        const double perRun = MeasureNanoseconds(1, [&](int) {
+            if (threads > 0) {
+                workspace.Handle(Command("replace-all \"(index|offset) % \" \"$1 / \""));
+                return;
+            }
+            for (int i = 0; i < fileCount; i++) {
+                workspace.Handle(Command("edit " + dir + "/file" + std::to_string(i)));
+                workspace.GetCurrentEditor()->Handle(Command("replace-re \"(index|offset) % \" \"$1 / \""));
+            }
+        }) / 1e6;
+        // saved, so that nothing is left in the journal
+        workspace.Handle(Command("save all"));
+        workspace.Handle(Command("exit"));
+        std::cout.rdbuf(console);
+        std::cout << (threads == 0 ? std::string("replace-re per editor") : "replace-all, " + std::to_string(threads) + " thread(s)")
+            << ": " << perRun << " ms for " << fileCount << " files" << std::endl;
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << "======== End of Regex Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchTrigramSearch() {
+    std::cout << "======== Benchmarking Trigram Search ========" << std::endl;
+    // many open files, the needle in a few lines of a few of them
+    constexpr int editorCount = 500;
+    constexpr int lineCount = 2000;
+    std::vector<Ref<Editor>> editors;
+    size_t bytes = 0;
+    for (int i = 0; i < editorCount; i++) {
+        EditorFileData data;
+        data.canonicalPath = "/bench/file" + std::to_string(i);
+        for (int line = 0; line < lineCount; line++) {
+            data.lines.push_back("    const auto value" + std::to_string(line) + " = compute(index, offset" + std::to_string(i % 10)
+                + ") + table[index % size];");
+            bytes += data.lines.back().size();
+        }
+        if (i % 50 == 0) {
+            data.lines[i % lineCount] += " // TODO: needle";
+        }
+        editors.push_back(CreateRef<Editor>(".bench-file" + std::to_string(i), std::move(data)));
+    }
+
+    for (const std::string needle : {"TODO: needle", "offset7) + table"}) {
+        size_t hits = 0;
+        const SubstringSearcher searcher(needle);
+        const double scanned = MeasureNanoseconds(3, [&](int) {
+            hits = 0;
+            for (const auto& editor : editors) {
+                hits += ForEachHit(editor->GetLines(), 0, lineCount - 1, searcher, [](const TextHit&) { return true; });
+            }
+        }) / 1e6;
+        std::cout << '"' << needle << "\", SubstringSearcher over " << bytes / (1 << 20) << " MiB: " << scanned << " ms, "
+            << hits << " hits" << std::endl;
+        const TrigramQuery query(needle);
+        size_t checked = 0;
+        const double built = MeasureNanoseconds(1, [&](int) {
+            for (const auto& editor : editors) {
+                editor->SearchIndexed(query, checked);
+            }
+        }) / 1e6;
+        const double indexed = MeasureNanoseconds(3, [&](int) {
+            hits = 0;
+            checked = 0;
+            for (const auto& editor : editors) {
+                hits += editor->SearchIndexed(query, checked).size();
+            }
+        }) / 1e6;
+        std::cout << '"' << needle << "\", indexed: " << indexed << " ms, " << hits << " hits, " << checked
+            << " line(s) searched, speedup: " << scanned / indexed << "x (the first search, building the indexes: "
+            << built << " ms)" << std::endl;
+    }
+    // an edit keeps the index, the next search does not rebuild it
+    const double edited = MeasureNanoseconds(100, [&](int i) {
+        editors[i]->Handle(Command("append \"one more TODO: needle\""));
+    }) / 1e3;
+    size_t checked = 0;
+    const TrigramQuery query("TODO: needle");
+    const double searched = MeasureNanoseconds(1, [&](int) {
+        for (const auto& editor : editors) {
+            g_Sink = g_Sink + editor->SearchIndexed(query, checked).size();
+        }
+    }) / 1e6;
+    std::cout << "append with the index kept: " << edited << " us, next search: " << searched << " ms" << std::endl;
+
+    std::cout << "======== End of Trigram Search Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchGrep() {
+    std::cout << "======== Benchmarking Grep ========" << std::endl;
+    const std::string root = ".bench-grep";
+    size_t bytes = 0;
+    for (int i = 0; i < 200; i++) {
+        const auto dir = root + "/d" + std::to_string(i % 10);
+        std::filesystem::create_directories(dir);
+        std::ofstream out(dir + "/f" + std::to_string(i));
+        for (int line = 0; line < 2000; line++) {
+            const auto text = "    const auto value" + std::to_string(line) + " = compute(index, offset) + table[index % size];"
+                + (line == i ? " // TODO: needle" : "");
+            out << text << '\n';
+            bytes += text.size() + 1;
+        }
+    }
+    const auto files = ListFiles(root, DirWalker().Walk(root));
+    const SubstringSearcher searcher("TODO: needle");
+
+    // what `load` and `find` on every file amount to
+    size_t hits = 0;
+    const double legacy = MeasureNanoseconds(3, [&](int) {
+        hits = 0;
+        for (const auto& file : files) {
+            const auto data = ReadEditorFile(file);
+            hits += ForEachHit(data.lines, 0, data.lines.size() - 1, searcher, [](const TextHit&) { return true; });
+        }
+    }) / 1e6;
+    std::cout << "ReadEditorFile + ForEachHit: " << legacy << " ms for " << bytes / (1 << 20) << " MiB in " << files.size()
+        << " files, " << hits << " hits" << std::endl;
+    for (const size_t threads : {1, 4}) {
+        ThreadPool pool(threads);
+        const double grepped = MeasureNanoseconds(3, [&](int) {
+            hits = SearchFiles(files, searcher, pool).hits.size();
+        }) / 1e6;
+        std::cout << "SearchFiles, " << threads << " thread(s): " << grepped << " ms, " << hits << " hits, speedup: "
+            << legacy / grepped << "x" << std::endl;
+    }
+    std::filesystem::remove_all(root);
+
+    std::cout << "======== End of Grep Benchmark ========" << std::endl << std::endl;
+}
+
+void BenchDiff() {
+    std::cout << "======== Benchmarking Diff ========" << std::endl;
+    constexpr int lineCount = 2000000;
+    const std::string path = "./.bench-diff";
+    {
+        std::ofstream out(path);
+        for (int line = 0; line < lineCount; line++) {
+            out << "    const auto value" << line << " = compute(index, offset) + table[index % size];\n";
+        }
+    }
+    Editor editor(path);
+    const Command diff("diff");
+    std::stringstream discarded;
+    auto* console = std::cout.rdbuf(discarded.rdbuf());
+
+    // the first diff splits and hashes the file and hashes the content
+    const double first = MeasureNanoseconds(1, [&](int) { editor.Handle(diff); }) / 1e6;
+    // an undo leaves the hashes behind, the diff after it hashes the content again
+    editor.Handle(Command("replace 1000:5 5 value"));
+    editor.Handle(Command("undo"));
+    const double rehashed = MeasureNanoseconds(1, [&](int) { editor.Handle(diff); }) / 1e6;
+    // edits keep the hashes, only they are compared. the edits are not timed, their undo snapshots
+    // copy the content
+    double repeated = 0;
+    for (int i = 0; i < 20; i++) {
+        editor.Handle(Command("replace " + std::to_string(i * 90000 + 1) + ":5 5 value"));
+        repeated += MeasureNanoseconds(1, [&](int) { editor.Handle(diff); }) / 1e6 / 20;
+    }
+
+    std::cout.rdbuf(console);
+    std::cout << "diff of " << lineCount << " lines, first: " << first << " ms, after an undo: " << rehashed
+        << " ms, after an edit, with the hashes kept: " << repeated << " ms, speedup: " << rehashed / repeated << "x"
+        << std::endl;
+    std::filesystem::remove(path);
+
+    std::cout << "======== End of Diff Benchmark ========" << std::endl << std::endl;
+}
@@ -1,9 +1,8 @@
 // Application.cpp
 
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <iostream>
+#include <mutex>
 #include "Application.h"
 
 #include <cassert>
@@ -11,16 +10,14 @@
 #include "Core.h"
 #include "Components/Workspace.h"
 #include "Command.h"
+#include "MappedFile.h"
 #include "Outputer.h"
 
 Application::Application()
 {
-	std::ifstream in("data/.editor_workspace");
-	std::stringstream buffer;
-	if (in) {
-		buffer << in.rdbuf();
-	}
-	m_Workspace = CreateScope<Workspace>(buffer.str());
+	// parsed straight from the mapping, which only has to outlive the constructor
+	const MappedFile state("data/.editor_workspace");
+	m_Workspace = CreateScope<Workspace>(state.GetView());
 }
 
 Application::~Application()
@@ -40,7 +37,8 @@ void Application::Run()
 		// validate the command with error info
 		if (!command.Validate())
 			continue;
-		// handle
+		// handle, the autosave thread waits until the command is done
+		std::lock_guard<std::mutex> lock(m_Workspace->GetCommandMutex());
 		switch (GetExecutorFromType(command.GetType()))
 		{
 		case CommandExecuting::Workspace:
@@ -59,5 +57,6 @@ void Application::Run()
 		default:
 			throw std::runtime_error("Unknown command");
 		}
+		m_Workspace->EnforceMemoryBudget();
 	}
 }
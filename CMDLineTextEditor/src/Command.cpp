@@ -18,10 +18,23 @@ std::unordered_map<std::string, Command::Type> Command::s_VerbToType = {
 	{"delete", Command::Type::Delete},
 	{"replace", Command::Type::Replace},
 	{"show", Command::Type::Show},
+	{"find", Command::Type::Find},
+	{"find-re", Command::Type::FindRe},
+	{"replace-re", Command::Type::ReplaceRe},
+	{"diff", Command::Type::Diff},
 
 	{"log-on", Command::Type::LogOn},
 	{"log-off", Command::Type::LogOff},
-	{"log-show", Command::Type::LogShow}
+	{"log-show", Command::Type::LogShow},
+	{"log-level", Command::Type::LogLevel},
+	{"export-json", Command::Type::ExportJson},
+	{"session-save", Command::Type::SessionSave},
+	{"autosave", Command::Type::Autosave},
+	{"recover", Command::Type::Recover},
+	{"mem-budget", Command::Type::MemBudget},
+	{"replace-all", Command::Type::ReplaceAll},
+	{"search", Command::Type::Search},
+	{"grep", Command::Type::Grep}
 };
 
 void Command::ParseArguments(const std::string& cmdText, size_t verbEnd) {
@@ -98,6 +111,24 @@ bool Command::Validate() const
 	return true;
 }
 
+bool Command::IsMutating() const
+{
+	switch (m_Type)
+	{
+	case Type::Append:
+	case Type::Insert:
+	case Type::Delete:
+	case Type::Replace:
+	case Type::ReplaceRe:
+	case Type::ReplaceAll:
+	case Type::Undo:
+	case Type::Redo:
+		return true;
+	default:
+		return false;
+	}
+}
+
 bool Command::ValidateArgNums() const
 {
 	switch (m_Type)
@@ -105,26 +136,43 @@ bool Command::ValidateArgNums() const
 	case Type::Undo: // 0
 	case Type::Redo: // 0
 	case Type::Exit: // 0
-	case Type::EditorList: // 0
 		return (m_Args.size() == 0); // NOLINT(*-container-size-empty)
-	case Type::Load: // 1
+	case Type::Load: // 1+
+		return (!m_Args.empty());
+	case Type::DirTree: // 0+, a directory and options
+		return true;
 	case Type::Edit: // 1
+	case Type::Search: // 1
 	case Type::Append: // 1
 		return (m_Args.size() == 1);
 	case Type::Insert: // 2
 	case Type::Delete: // 2
+	case Type::ReplaceAll: // 2
 		return (m_Args.size() == 2);
 	case Type::Replace: // 3
 		return (m_Args.size() == 3);
-	case Type::Save: // 0 1
+	case Type::ReplaceRe: // 2 3
+		return (m_Args.size() == 2 || m_Args.size() == 3);
+	case Type::EditorList: // 0 1
 	case Type::Close: // 0 1
-	case Type::DirTree: // 0 1
 	case Type::Show: // 0 1
+	case Type::Diff: // 0 1
 	case Type::LogOn: // 0 1
 	case Type::LogOff: // 0 1
 	case Type::LogShow: // 0 1
+	case Type::ExportJson: // 0 1
+	case Type::SessionSave: // 0 1
+	case Type::Autosave: // 0 1
+	case Type::Recover: // 0 1
+	case Type::MemBudget: // 0 1
 		return (m_Args.size() <= 1);
+	case Type::Save: // 0 1 2
+		return (m_Args.size() <= 2);
 	case Type::Init: // 1 2
+	case Type::Find: // 1 2
+	case Type::Grep: // 1 2
+	case Type::FindRe: // 1 2
+	case Type::LogLevel: // 1 2
 		return (m_Args.size() == 1 || m_Args.size() == 2);
 	default:
 		return false;
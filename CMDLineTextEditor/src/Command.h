@@ -12,8 +12,8 @@ public:
 	enum class Type {
 		None,
 		WorkspaceCommandBegin, Load, Save, Init, Close, Edit,
-		EditorList, DirTree, Exit, LogOn, LogOff, LogShow, WorkspaceCommandEnd,
-		EditorCommandBegin, Append, Insert, Delete, Replace, Show, Undo, Redo, EditorCommandEnd,
+		EditorList, DirTree, Exit, LogOn, LogOff, LogShow, LogLevel, ExportJson, SessionSave, Autosave, Recover, MemBudget, ReplaceAll, Search, Grep, WorkspaceCommandEnd,
+		EditorCommandBegin, Append, Insert, Delete, Replace, Show, Find, FindRe, ReplaceRe, Diff, Undo, Redo, EditorCommandEnd,
 	};
 
 	Command() = default;
@@ -21,6 +21,8 @@ public:
 	~Command() = default;
 
 	bool Validate() const;
+	// whether the command changes the contents of an editor
+	bool IsMutating() const;
 
 	const std::string& GetVerb() const				{ return m_Verb; }
 	const std::string& GetLine() const				{ return m_Line; }
@@ -0,0 +1,138 @@
+#include "AutosaveService.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "Editor.h"
+#include "Outputer.h"
+
+AutosaveService::AutosaveService(std::function<void()> task)
+    : m_Task(std::move(task))
+{
+}
+
+AutosaveService::~AutosaveService() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_Wake.notify_all();
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+}
+
+void AutosaveService::SetInterval(std::chrono::seconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Interval = std::max(interval, std::chrono::seconds(0));
+        m_Delay = m_Interval;
+        if (m_Interval.count() > 0 && !m_Thread.joinable()) {
+            m_Thread = std::thread(&AutosaveService::Run, this);
+        }
+    }
+    m_Wake.notify_all();
+}
+
+std::chrono::seconds AutosaveService::GetInterval() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Interval;
+}
+
+std::chrono::milliseconds AutosaveService::GetDelay() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Delay;
+}
+
+std::chrono::milliseconds AutosaveService::GetLastDuration() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_LastDuration;
+}
+
+void AutosaveService::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (!m_Stopping) {
+        if (m_Interval.count() == 0) {
+            m_Wake.wait(lock, [this]() { return m_Stopping || m_Interval.count() > 0; });
+            continue;
+        }
+        // a new interval wakes the thread and starts the wait again
+        const auto interval = m_Interval;
+        const auto deadline = std::chrono::steady_clock::now() + m_Delay;
+        if (m_Wake.wait_until(lock, deadline, [&]() { return m_Stopping || m_Interval != interval; }))
+            continue;
+
+        lock.unlock();
+        const auto begin = std::chrono::steady_clock::now();
+        try {
+            m_Task();
+        } catch (const std::exception& e) {
+            Outputer::InfoLn() << "Autosave failed: " << e.what();
+        }
+        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - begin);
+        lock.lock();
+
+        m_LastDuration = duration;
+        if (m_Interval != interval)
+            continue;
+        const std::chrono::milliseconds base = m_Interval;
+        if (duration * 10 > base) {
+            m_Delay = std::min(m_Delay * 2, base * 8);
+        } else {
+            m_Delay = std::max(m_Delay / 2, base);
+        }
+    }
+}
+
+namespace {
+const char* const RecoveryDirectory = "data/.recovery";
+}
+
+std::string AutosaveService::GetRecoveryPath(const std::string& canonicalPath) {
+    return std::string(RecoveryDirectory) + "/" + GetPathHashName(canonicalPath);
+}
+
+bool AutosaveService::WriteRecoveryFile(const std::string& canonicalPath, const std::vector<std::string>& lines) {
+    std::error_code ec;
+    std::filesystem::create_directories(RecoveryDirectory, ec);
+    const auto path = GetRecoveryPath(canonicalPath);
+    const auto tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary);
+        if (!out.is_open())
+            return false;
+        out << canonicalPath << '\n';
+        for (const auto& line : lines) {
+            out << line << '\n';
+        }
+        if (!out)
+            return false;
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    return !ec;
+}
+
+bool AutosaveService::ReadRecoveryFile(const std::string& canonicalPath, std::vector<std::string>& lines) {
+    std::ifstream in(GetRecoveryPath(canonicalPath), std::ios::binary);
+    std::string owner;
+    // a hash collision shows up as another path on the first line
+    if (!in.is_open() || !std::getline(in, owner) || owner != canonicalPath)
+        return false;
+    lines.clear();
+    for (std::string line; std::getline(in, line); ) {
+        lines.push_back(std::move(line));
+    }
+    return true;
+}
+
+void AutosaveService::RemoveRecoveryFile(const std::string& canonicalPath) {
+    std::error_code ec;
+    std::filesystem::remove(GetRecoveryPath(canonicalPath), ec);
+}
+
+void AutosaveService::RemoveAllRecoveryFiles() {
+    std::error_code ec;
+    std::filesystem::remove_all(RecoveryDirectory, ec);
+}
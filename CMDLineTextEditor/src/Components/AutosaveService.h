@@ -0,0 +1,49 @@
+// AutosaveService.h
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// runs a save task on a background thread every interval. when a run takes longer than a tenth
+// of the interval, e.g. because the disk is busy, the delay doubles up to eight intervals
+// and shrinks back once runs are fast again
+class AutosaveService {
+public:
+    explicit AutosaveService(std::function<void()> task);
+    ~AutosaveService();
+    AutosaveService(const AutosaveService&) = delete;
+    AutosaveService& operator=(const AutosaveService&) = delete;
+
+    // zero turns autosaving off, the thread is started on first use
+    void SetInterval(std::chrono::seconds interval);
+    std::chrono::seconds GetInterval() const;
+    // the delay before the next run, longer than the interval while backing off
+    std::chrono::milliseconds GetDelay() const;
+    std::chrono::milliseconds GetLastDuration() const;
+
+    // recovery files live in data/.recovery, named after a hash of the canonical path
+    // which is repeated on their first line
+    static std::string GetRecoveryPath(const std::string& canonicalPath);
+    static bool WriteRecoveryFile(const std::string& canonicalPath, const std::vector<std::string>& lines);
+    static bool ReadRecoveryFile(const std::string& canonicalPath, std::vector<std::string>& lines);
+    static void RemoveRecoveryFile(const std::string& canonicalPath);
+    static void RemoveAllRecoveryFiles();
+
+private:
+    void Run();
+
+private:
+    std::function<void()> m_Task;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Wake;
+    std::chrono::seconds m_Interval{0};
+    std::chrono::milliseconds m_Delay{0};
+    std::chrono::milliseconds m_LastDuration{0};
+    bool m_Stopping = false;
+    std::thread m_Thread;
+};
@@ -0,0 +1,276 @@
+#include "EditJournal.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Outputer.h"
+
+namespace {
+    const char* const s_SavedMarker = "#saved";
+    const char* const s_ClosedMarker = "#closed";
+    const char* const s_ChangeMarker = "#change ";
+
+    // lines of a change are separated by tabs, so tabs and backslashes in them are escaped
+    void AppendEscaped(std::string& out, const std::string& line) {
+        for (const char c : line) {
+            if (c == '\\') {
+                out += "\\\\";
+            } else if (c == '\t') {
+                out += "\\t";
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    bool Unescape(const std::string& text, size_t begin, size_t end, std::string& line) {
+        line.clear();
+        for (size_t i = begin; i < end; i++) {
+            if (text[i] != '\\') {
+                line += text[i];
+                continue;
+            }
+            if (++i == end)
+                return false;
+            if (text[i] == 't') {
+                line += '\t';
+            } else if (text[i] == '\\') {
+                line += '\\';
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SyncFile(std::FILE* file) {
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+}
+
+JournalChange MakeJournalChange(const std::vector<std::string>& before, const std::vector<std::string>& after) {
+    size_t prefix = 0;
+    while (prefix < before.size() && prefix < after.size() && before[prefix] == after[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < before.size() - prefix && suffix < after.size() - prefix
+        && before[before.size() - 1 - suffix] == after[after.size() - 1 - suffix]) {
+        suffix++;
+    }
+    JournalChange change;
+    change.first = prefix;
+    change.removed = before.size() - prefix - suffix;
+    change.lines.assign(after.begin() + prefix, after.end() - suffix);
+    return change;
+}
+
+EditJournal::EditJournal(const std::string& path, std::chrono::milliseconds commitInterval)
+    : m_Path(path), m_CommitInterval(commitInterval)
+{
+    std::filesystem::path fp(m_Path);
+    std::error_code ec;
+    if (!fp.parent_path().empty()) {
+        std::filesystem::create_directories(fp.parent_path(), ec);
+    }
+    m_File = std::fopen(m_Path.c_str(), "ab");
+    if (!m_File) {
+        Outputer::InfoLn() << "Could not open edit journal `" << m_Path << "`, unsaved edits will not be recoverable";
+    }
+    m_Writer = std::thread(&EditJournal::Run, this);
+}
+
+EditJournal::~EditJournal() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_WakeWriter.notify_all();
+    m_Writer.join();
+    if (m_File) {
+        std::fclose(m_File);
+    }
+}
+
+void EditJournal::Append(const std::string& filePath, const std::string& commandLine) {
+    Push(filePath + '\t' + commandLine + '\n');
+}
+
+void EditJournal::AppendChange(const std::string& filePath, const JournalChange& change) {
+    std::string record = filePath + '\t' + s_ChangeMarker + std::to_string(change.first) + ' ' + std::to_string(change.removed);
+    for (const auto& line : change.lines) {
+        record += '\t';
+        AppendEscaped(record, line);
+    }
+    Push(record + '\n');
+}
+
+bool EditJournal::ParseChange(const std::string& record, JournalChange& change) {
+    const std::string marker = s_ChangeMarker;
+    if (record.compare(0, marker.size(), marker) != 0)
+        return false;
+    const auto space = record.find(' ', marker.size());
+    const auto end = std::min(record.find('\t', marker.size()), record.size());
+    if (space == std::string::npos || space > end)
+        return false;
+    const auto first = record.substr(marker.size(), space - marker.size());
+    const auto removed = record.substr(space + 1, end - space - 1);
+    for (const auto* number : {&first, &removed}) {
+        if (number->empty() || number->size() > 18 || number->find_first_not_of("0123456789") != std::string::npos)
+            return false;
+    }
+    change.first = std::stoull(first);
+    change.removed = std::stoull(removed);
+    change.lines.clear();
+    for (size_t begin = end; begin < record.size(); ) {
+        const auto next = std::min(record.find('\t', begin + 1), record.size());
+        if (!Unescape(record, begin + 1, next, change.lines.emplace_back()))
+            return false;
+        begin = next;
+    }
+    return true;
+}
+
+void EditJournal::MarkSaved(const std::string& filePath) {
+    Push(filePath + '\t' + s_SavedMarker + '\n');
+}
+
+void EditJournal::MarkClosed(const std::string& filePath) {
+    Push(filePath + '\t' + s_ClosedMarker + '\n');
+}
+
+bool EditJournal::Commit() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    const auto target = m_Appended;
+    m_CommitRequested = true;
+    m_WakeWriter.notify_all();
+    m_Committed.wait(lock, [&] { return m_Broken || m_Durable >= target; });
+    return m_Durable >= target;
+}
+
+void EditJournal::Clear() {
+    Commit();
+    {
+        // nothing written before is needed any more, so a broken journal starts over
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Broken = false;
+    }
+    std::lock_guard<std::mutex> fileLock(m_FileMutex);
+    if (m_File) {
+        std::fclose(m_File);
+    }
+    m_File = std::fopen(m_Path.c_str(), "wb");
+    if (m_File) {
+        SyncFile(m_File);
+        std::fclose(m_File);
+    }
+    m_File = std::fopen(m_Path.c_str(), "ab");
+}
+
+EditJournal::PendingEdits EditJournal::ReadPending(const std::string& path) {
+    PendingEdits result;
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return result;
+    std::unordered_map<std::string, size_t> indexOfPath;
+    for (std::string line; std::getline(in, line); ) {
+        const auto tab = line.find('\t');
+        if (tab == std::string::npos || in.eof())
+            continue; // torn record from a crash during the last write
+        auto filePath = line.substr(0, tab);
+        auto commandLine = line.substr(tab + 1);
+        auto [it, inserted] = indexOfPath.try_emplace(filePath, result.size());
+        if (inserted) {
+            result.emplace_back(std::move(filePath), std::vector<std::string>());
+        }
+        auto& commands = result[it->second].second;
+        if (commandLine == s_SavedMarker || commandLine == s_ClosedMarker) {
+            commands.clear();
+        } else {
+            commands.push_back(std::move(commandLine));
+        }
+    }
+    PendingEdits pending;
+    for (auto& entry : result) {
+        if (!entry.second.empty()) {
+            pending.push_back(std::move(entry));
+        }
+    }
+    return pending;
+}
+
+std::vector<std::string> EditJournal::ReadSettled(const std::string& path) {
+    std::vector<std::string> result;
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return result;
+    for (std::string line; std::getline(in, line); ) {
+        const auto tab = line.find('\t');
+        if (tab == std::string::npos || in.eof())
+            continue;
+        const auto commandLine = line.substr(tab + 1);
+        auto filePath = line.substr(0, tab);
+        if ((commandLine == s_SavedMarker || commandLine == s_ClosedMarker)
+            && std::find(result.begin(), result.end(), filePath) == result.end()) {
+            result.push_back(std::move(filePath));
+        }
+    }
+    return result;
+}
+
+void EditJournal::Push(std::string record) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Pending += record;
+    m_Appended++;
+    m_WakeWriter.notify_all();
+}
+
+void EditJournal::Run() {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true) {
+        m_WakeWriter.wait(lock, [&] { return m_Stopping || !m_Pending.empty(); });
+        if (m_Pending.empty() && m_Stopping)
+            break;
+        // give the following records a chance to join this group
+        m_WakeWriter.wait_for(lock, m_CommitInterval, [&] { return m_Stopping || m_CommitRequested; });
+        std::string batch;
+        batch.swap(m_Pending);
+        const auto upTo = m_Appended;
+        m_CommitRequested = false;
+        const bool broken = m_Broken;
+
+        lock.unlock();
+        const bool written = !broken && WriteAndSync(batch);
+        lock.lock();
+
+        // a later group must not vouch for this one, so the journal stays broken
+        if (written) {
+            m_Durable = upTo;
+        } else if (!broken) {
+            m_Broken = true;
+            Outputer::InfoLn() << "Failed to write edit journal `" << m_Path << "`, unsaved edits will not be recoverable";
+        }
+        m_Committed.notify_all();
+    }
+}
+
+bool EditJournal::WriteAndSync(const std::string& data) {
+    std::lock_guard<std::mutex> fileLock(m_FileMutex);
+    if (!m_File)
+        return false;
+    if (std::fwrite(data.data(), 1, data.size(), m_File) != data.size())
+        return false;
+    return std::fflush(m_File) == 0 && SyncFile(m_File);
+}
@@ -0,0 +1,81 @@
+// EditJournal.h
+
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// lines `first` to `first + removed` of a buffer replaced by `lines`, journaled for changes
+// that cannot be replayed as the command that made them
+struct JournalChange {
+    size_t first = 0;
+    size_t removed = 0;
+    std::vector<std::string> lines;
+};
+
+// the smallest change between two buffers that keeps their common first and last lines
+JournalChange MakeJournalChange(const std::vector<std::string>& before, const std::vector<std::string>& after);
+
+// write-ahead journal of mutating editor commands, one `<path>\t<command>` per line.
+// records are committed in groups by a background thread, one fsync per group.
+// once a group fails to be written the journal is broken until the next Clear, nothing is
+// reported durable and Commit returns false
+class EditJournal {
+public:
+    using PendingEdits = std::vector<std::pair<std::string, std::vector<std::string>>>;
+
+    explicit EditJournal(const std::string& path,
+        std::chrono::milliseconds commitInterval = std::chrono::milliseconds(20));
+    ~EditJournal();
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    void Append(const std::string& filePath, const std::string& commandLine);
+    // the result of a change, e.g. an undo, whose command depends on history the replay does not have
+    void AppendChange(const std::string& filePath, const JournalChange& change);
+    // the buffer of the file now matches the disk, earlier records are obsolete
+    void MarkSaved(const std::string& filePath);
+    // the buffer of the file was dropped, earlier records are obsolete
+    void MarkClosed(const std::string& filePath);
+    // blocks until everything appended so far is durable, false when it could not be written
+    bool Commit();
+    // drops the whole journal, used after a clean exit
+    void Clear();
+
+    const std::string& GetPath() const { return m_Path; }
+
+    // commands of every file that were not followed by a save or close, in journal order
+    static PendingEdits ReadPending(const std::string& path);
+    // files that were saved or closed since the journal was cleared, their disk content is current
+    static std::vector<std::string> ReadSettled(const std::string& path);
+    // whether a pending record is a change written by AppendChange, read into `change` if so
+    static bool ParseChange(const std::string& record, JournalChange& change);
+
+private:
+    void Push(std::string record);
+    void Run();
+    bool WriteAndSync(const std::string& data);
+
+private:
+    std::string m_Path;
+    std::chrono::milliseconds m_CommitInterval;
+    std::mutex m_FileMutex;
+    std::FILE* m_File = nullptr;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeWriter;
+    std::condition_variable m_Committed;
+    std::string m_Pending;
+    uint64_t m_Appended = 0;
+    uint64_t m_Durable = 0;
+    bool m_Broken = false;
+    bool m_CommitRequested = false;
+    bool m_Stopping = false;
+    std::thread m_Writer;
+};
@@ -1,10 +1,21 @@
 #include "Editor.h"
 
 #include <cassert>
+#include <cstdio>
 #include <filesystem>
 #include <fstream>
+#include <utility>
 
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
 #include "Outputer.h"
+#include "SessionImage.h"
 
 std::pair<int, int> ParseRange(const std::string& range) {
     const auto seperator = range.find(':');
@@ -28,6 +39,26 @@ std::vector<std::string> ParseLineBreaks(const std::string& line, const std::str
     }
 }
 
+std::string CanonicalizePath(const std::string& path) {
+    std::error_code ec;
+    auto absolute = std::filesystem::absolute(path, ec);
+    if (ec) {
+        return std::filesystem::path(path).lexically_normal().string();
+    }
+    auto canonical = std::filesystem::weakly_canonical(absolute, ec);
+    if (ec) {
+        return absolute.lexically_normal().string();
+    }
+    return canonical.string();
+}
+
+std::string GetPathHashName(const std::string& canonicalPath) {
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx",
+        static_cast<unsigned long long>(std::hash<std::string>()(canonicalPath)));
+    return name;
+}
+
 // const std::unordered_map<Command::Type, Editor::CommandStrategy> Editor::s_HandlerMethods = {
 //     {Command::Type::Append,  &Editor::HandleAppend},
 //     {Command::Type::Insert,  &Editor::HandleInsert},
@@ -40,32 +71,183 @@ std::vector<std::string> ParseLineBreaks(const std::string& line, const std::str
 
 Editor::Editor() = default;
 
+Editor::~Editor() {
+    if (IsEvicted()) {
+        std::error_code ec;
+        std::filesystem::remove(m_SwapPath, ec);
+    }
+}
+
 Editor::Editor(const std::string& filePathText, LogMode logMode)
-    : m_FilePath(filePathText), m_LastTime(std::chrono::system_clock::now())
+    : Editor(filePathText, ReadEditorFile(filePathText), logMode)
 {
-    std::filesystem::path fp(m_FilePath);
+}
+
+Editor::Editor(const std::string& filePathText, EditorFileData fileData, LogMode logMode)
+{
+    InitWithPath(filePathText, std::move(fileData.canonicalPath));
+    Load(std::move(fileData), logMode);
+}
+
+Ref<Editor> Editor::CreateUnloaded(const std::string& filePathText, LogMode logMode, bool modified) {
+    auto editor = CreateRef<Editor>();
+    editor->InitWithPath(filePathText, CanonicalizePath(filePathText));
+    editor->m_Data.logMode = logMode;
+    editor->m_Data.modified = modified;
+    return editor;
+}
+
+EditorFileData ReadEditorFile(const std::string& filePath) {
+    EditorFileData data;
+    data.canonicalPath = CanonicalizePath(filePath);
+    std::filesystem::path fp(filePath);
     if (!std::filesystem::exists(fp.parent_path())) {
         std::filesystem::create_directories(fp.parent_path());
     }
     if (!std::filesystem::is_directory(fp.parent_path())) {
-        throw std::runtime_error("The parent directory of `" + filePathText + "` is an existing file");
+        throw std::runtime_error("The parent directory of `" + filePath + "` is an existing file");
     }
-    m_Data.modified = false;
-    std::ifstream in(filePathText);
+    std::ifstream in(filePath);
     if (!in.is_open()) {
-        std::ofstream out(filePathText);
+        std::ofstream out(filePath);
         if (!out.is_open())
-            throw std::runtime_error("Could not open file: " + filePathText);
+            throw std::runtime_error("Could not open file: " + filePath);
         out.close();
 
-        in.open(filePathText);;
+        in.open(filePath);
         if (!in.is_open())
-            throw std::runtime_error("Could not open newly created file: " + filePathText);
-        m_Data.modified = true;
+            throw std::runtime_error("Could not open newly created file: " + filePath);
+        data.created = true;
     }
     for (std::string line; std::getline(in, line); ) {
-        m_Data.lines.push_back(line);
+        data.lines.push_back(std::move(line));
     }
+    return data;
+}
+
+namespace {
+
+// the file a chain of symbolic links ends at, so that a save replaces the file and keeps the links
+std::filesystem::path ResolveLinks(std::filesystem::path path) {
+    std::error_code ec;
+    for (int hops = 0; hops < 40 && std::filesystem::is_symlink(path, ec); hops++) {
+        const auto link = std::filesystem::read_symlink(path, ec);
+        if (ec)
+            break;
+        path = link.is_absolute() ? link : path.parent_path() / link;
+    }
+    return path;
+}
+
+#ifndef _WIN32
+bool WriteAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const auto written = write(fd, data, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// makes a rename in the directory durable
+void SyncDirectory(const std::filesystem::path& directory) {
+    const int fd = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+#endif
+
+} // namespace
+
+uintmax_t WriteEditorFile(const std::string& filePath, const std::vector<std::string>& lines) {
+    const auto target = ResolveLinks(filePath);
+    const auto tempPath = target.string() + ".saving";
+    uintmax_t bytes = 0;
+#ifdef _WIN32
+    {
+        std::ofstream out(tempPath);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not open file: " + tempPath);
+        }
+        for (const auto& line : lines) {
+            out << line << '\n';
+            bytes += line.size() + 1;
+        }
+        out.flush();
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tempPath);
+            throw std::runtime_error("Could not write file: " + tempPath);
+        }
+    }
+    std::error_code ec;
+    const auto permissions = std::filesystem::status(target, ec).permissions();
+    if (!ec) {
+        std::filesystem::permissions(tempPath, permissions, ec);
+    }
+#else
+    struct stat original {};
+    const bool existed = stat(target.c_str(), &original) == 0;
+    const int fd = open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + tempPath);
+    }
+    // the owner first, changing it may clear the set-id bits the mode brings back
+    if (existed) {
+        (void)fchown(fd, original.st_uid, original.st_gid);
+        fchmod(fd, original.st_mode & 07777);
+    }
+    std::string buffer;
+    bool written = true;
+    for (size_t i = 0; i < lines.size() && written; i++) {
+        buffer += lines[i];
+        buffer += '\n';
+        bytes += lines[i].size() + 1;
+        if (buffer.size() >= 64 * 1024 || i + 1 == lines.size()) {
+            written = WriteAll(fd, buffer.data(), buffer.size());
+            buffer.clear();
+        }
+    }
+    // the content has to be on disk before the rename makes it the file
+    written = written && fsync(fd) == 0;
+    written = close(fd) == 0 && written;
+    if (!written) {
+        std::error_code ec;
+        std::filesystem::remove(tempPath, ec);
+        throw std::runtime_error("Could not write file: " + tempPath);
+    }
+    std::error_code ec;
+#endif
+    std::filesystem::rename(tempPath, target, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        throw std::runtime_error("Could not replace file: " + filePath);
+    }
+#ifndef _WIN32
+    SyncDirectory(target.parent_path());
+#endif
+    return bytes;
+}
+
+void Editor::InitWithPath(const std::string& filePathText, std::string canonicalPath) {
+    m_FilePath = filePathText;
+    m_CanonicalPath = std::move(canonicalPath);
+    m_LastTime = std::chrono::system_clock::now();
+    std::filesystem::path fp(m_FilePath);
+    auto loggingPath = fp.parent_path().string() + "/." + fp.filename().string() + ".log";
+    m_Logger = CreateRef<Logger>(loggingPath);
+    RegisterCommandHandlingStrategies();
+}
+
+void Editor::Load(EditorFileData fileData, LogMode logMode) {
+    m_Data.modified = fileData.created;
+    m_Data.lines = std::move(fileData.lines);
     if (!m_Data.lines.empty()) {
         if (m_Data.lines[0] == "# log") {
             m_Data.logMode = LogMode::WithLog;
@@ -74,65 +256,533 @@ Editor::Editor(const std::string& filePathText, LogMode logMode)
     if (logMode != LogMode::None) {
         m_Data.logMode = logMode;
     }
-    auto loggingPath = fp.parent_path().string() + "/." + fp.filename().string() + ".log";
-    m_Logger = CreateRef<Logger>(loggingPath);
-    RegisterCommandHandlingStrategies();
+    m_Loaded = true;
+}
+
+void Editor::EnsureLoaded() {
+    if (m_Loaded)
+        return;
+    if (!IsEvicted()) {
+        LoadFrom(ReadEditorFile(m_FilePath));
+        return;
+    }
+    EditorSession session;
+    {
+        const MappedFile swap(m_SwapPath);
+        if (!SessionImage::DeserializeContent(swap.GetView(), session))
+            throw std::runtime_error("Corrupt swap file: " + m_SwapPath);
+    }
+    // the content did not change while it was swapped out
+    const auto revision = m_Revision;
+    RestoreSession(std::move(session));
+    m_Revision = revision;
+    std::error_code ec;
+    std::filesystem::remove(m_SwapPath, ec);
+    m_SwapPath.clear();
+}
+
+bool Editor::Evict() {
+    if (!m_Loaded)
+        return false;
+    const auto bytes = SessionImage::SerializeContent(CaptureSession());
+    std::error_code ec;
+    std::filesystem::create_directories("data/.swap", ec);
+    const auto swapPath = "data/.swap/" + GetPathHashName(m_CanonicalPath);
+    {
+        std::ofstream out(swapPath, std::ios::binary);
+        if (!out.is_open())
+            return false;
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        if (!out)
+            return false;
+    }
+    m_SwapPath = swapPath;
+    // swap with empty containers, clear() would keep the capacity
+    std::vector<std::string>().swap(m_Data.lines);
+    std::vector<Scope<EditorData>>().swap(m_UndoStack);
+    std::vector<Scope<EditorData>>().swap(m_RedoStack);
+    // only the trigram index stays, searching evicted editors needs it. the rest is built again for `diff`
+    std::vector<uint64_t>().swap(m_LineHashes);
+    m_HashRevision = UINT64_MAX;
+    m_DiskLines = {};
+    m_Loaded = false;
+    m_CountedRevision = UINT64_MAX;
+    return true;
+}
+
+void Editor::DropIndex() {
+    m_Trigrams.Clear();
+    m_TrigramRevision = UINT64_MAX;
+}
+
+size_t Editor::GetResidentBytes() {
+    const auto indexBytes = m_Trigrams.GetMemoryBytes() + m_LineHashes.capacity() * sizeof(uint64_t)
+        + m_DiskLines.lines.begins.capacity() * sizeof(size_t) + m_DiskLines.lines.hashes.capacity() * sizeof(uint64_t);
+    if (!m_Loaded)
+        return indexBytes;
+    if (m_CountedRevision == m_Revision)
+        return m_ResidentBytes + indexBytes;
+    const auto countLines = [](const std::vector<std::string>& lines) {
+        size_t bytes = lines.capacity() * sizeof(std::string);
+        for (const auto& line : lines) {
+            bytes += line.size();
+        }
+        return bytes;
+    };
+    m_ResidentBytes = countLines(m_Data.lines);
+    for (const auto* stack : {&m_UndoStack, &m_RedoStack}) {
+        for (const auto& snapshot : *stack) {
+            m_ResidentBytes += sizeof(EditorData) + countLines(snapshot->lines);
+        }
+    }
+    m_CountedRevision = m_Revision;
+    return m_ResidentBytes + indexBytes;
+}
+
+uintmax_t Editor::GetSwapBytes() const {
+    std::error_code ec;
+    const auto size = IsEvicted() ? std::filesystem::file_size(m_SwapPath, ec) : 0;
+    return ec ? 0 : size;
+}
+
+void Editor::LoadFrom(EditorFileData fileData) {
+    if (m_Loaded || IsEvicted())
+        return;
+    // the state restored with the stub wins over what the file says
+    const auto logMode = m_Data.logMode;
+    const bool modified = m_Data.modified;
+    Load(std::move(fileData), LogMode::None);
+    m_Data.logMode = logMode;
+    m_Data.modified = m_Data.modified || modified;
+}
+
+EditorSession Editor::CaptureSession() const {
+    EditorSession session;
+    session.path = m_FilePath;
+    session.data = m_Data;
+    for (const auto& snapshot : m_UndoStack) {
+        session.undo.push_back(*snapshot);
+    }
+    for (const auto& snapshot : m_RedoStack) {
+        session.redo.push_back(*snapshot);
+    }
+    return session;
+}
+
+void Editor::RestoreSession(EditorSession session) {
+    m_Data = std::move(session.data);
+    m_UndoStack.clear();
+    for (auto& snapshot : session.undo) {
+        m_UndoStack.push_back(CreateScope<EditorData>(std::move(snapshot)));
+    }
+    m_RedoStack.clear();
+    for (auto& snapshot : session.redo) {
+        m_RedoStack.push_back(CreateScope<EditorData>(std::move(snapshot)));
+    }
+    m_Loaded = true;
+    m_Revision++;
+    m_CountedRevision = UINT64_MAX;
+}
+
+void Editor::ReplaceContent(std::vector<std::string> lines) {
+    EnsureLoaded();
+    MODIFICATION_SCOPE;
+    m_Data.lines = std::move(lines);
 }
 
 void Editor::Handle(const Command& command)
 {
+    try {
+        EnsureLoaded();
+    } catch (const std::exception& e) {
+        Outputer::ErrorLn(command) << "Failed to load file: " << e.what();
+        return;
+    }
     bool success = false;
     if (m_Dispatcher.Dispatch(this, command)) {
         success = true;
     } else {
         Outputer::ErrorLn(command) << "Command not handled in workspace.";
     }
+    if (success && m_Journal && command.IsMutating()) {
+        // replay starts from the file with no history, so undo and redo are journaled as what they changed
+        if (command.GetType() == Command::Type::Undo) {
+            m_Journal->AppendChange(m_FilePath, MakeJournalChange(m_RedoStack.back()->lines, m_Data.lines));
+        } else if (command.GetType() == Command::Type::Redo) {
+            m_Journal->AppendChange(m_FilePath, MakeJournalChange(m_UndoStack.back()->lines, m_Data.lines));
+        } else {
+            m_Journal->Append(m_FilePath, command.GetLine());
+        }
+    }
     if (success && m_Data.logMode == LogMode::WithLog) {
         m_Logger->Log(command);
     }
 }
 
+bool Editor::Replay(const Command& command) {
+    EnsureLoaded();
+    return m_Dispatcher.Dispatch(this, command);
+}
+
+bool Editor::Replay(const JournalChange& change) {
+    EnsureLoaded();
+    if (change.first > m_Data.lines.size() || change.removed > m_Data.lines.size() - change.first)
+        return false;
+    MODIFICATION_SCOPE;
+    const auto first = m_Data.lines.begin() + static_cast<std::ptrdiff_t>(change.first);
+    m_Data.lines.erase(first, first + static_cast<std::ptrdiff_t>(change.removed));
+    m_Data.lines.insert(m_Data.lines.begin() + static_cast<std::ptrdiff_t>(change.first), change.lines.begin(), change.lines.end());
+    return true;
+}
+
 void Editor::RegisterCommandHandlingStrategies() {
     m_Dispatcher.Register(Command::Type::Append, &Editor::HandleAppend);
     m_Dispatcher.Register(Command::Type::Insert, &Editor::HandleInsert);
     m_Dispatcher.Register(Command::Type::Delete, &Editor::HandleDelete);
     m_Dispatcher.Register(Command::Type::Replace, &Editor::HandleReplace);
     m_Dispatcher.Register(Command::Type::Show, &Editor::HandleShow);
+    m_Dispatcher.Register(Command::Type::Find, &Editor::HandleFind);
+    m_Dispatcher.Register(Command::Type::FindRe, &Editor::HandleFindRe);
+    m_Dispatcher.Register(Command::Type::ReplaceRe, &Editor::HandleReplaceRe);
+    m_Dispatcher.Register(Command::Type::Diff, &Editor::HandleDiff);
     m_Dispatcher.Register(Command::Type::Undo, &Editor::HandleUndo);
     m_Dispatcher.Register(Command::Type::Redo, &Editor::HandleRedo);
 }
 
+/**
+ * `show [from:to]` prints lines, `show @N` the line of the N-th hit of the last `find` or `find-re`
+ * with a caret under it
+ */
 bool Editor::HandleShow(const Command& command) {
     int from = 0, to = static_cast<int>(m_Data.lines.size()) - 1;
     if (!command.GetArgs().empty()) {
-        try {
-            auto rangeStr = command.GetArgs()[0];
-            auto r = ParseRange(rangeStr);
-            from = r.first - 1;
-            to = r.second - 1;
-        } catch (const std::exception&) {
-            Outputer::ErrorLn(command) << "Invalid range format";
+        const auto& arg = command.GetArgs()[0];
+        if (!arg.empty() && arg[0] == '@')
+            return ShowHit(command, arg.substr(1));
+        if (!GetAndValidateLineRange(command, arg, from, to))
             return false;
+    }
+
+    for (int i = std::max(0, from); i < m_Data.lines.size() && i <= to; i++) {
+        Outputer::Out() << m_Data.lines[i] << '\n';
+    }
+    return true;
+}
+
+bool Editor::ShowHit(const Command& command, const std::string& hitText) {
+    if (hitText.empty() || hitText.size() > 9 || hitText.find_first_not_of("0123456789") != std::string::npos
+        || std::stoul(hitText) == 0) {
+        Outputer::ErrorLn(command) << "Invalid hit number: " << hitText;
+        return false;
+    }
+    if (!m_LastFind.searcher && !m_LastFind.regex) {
+        Outputer::ErrorLn(command) << "Nothing found yet, use `find` first";
+        return false;
+    }
+    if (m_LastFind.revision != m_Revision) {
+        Outputer::ErrorLn(command) << "The content changed since the last `find`";
+        return false;
+    }
+    const size_t wanted = std::stoul(hitText);
+    TextHit found{};
+    const auto hits = ForEachFoundHit([&, seen = size_t(0)](const TextHit& hit) mutable {
+        found = hit;
+        return ++seen < wanted;
+    });
+    if (hits < wanted) {
+        Outputer::ErrorLn(command) << "No hit @" << wanted << ", the last `find` had " << hits;
+        return false;
+    }
+    Outputer::Out() << found.line + 1 << ':' << found.column + 1 << '\n'
+        << m_Data.lines[found.line] << '\n'
+        << std::string(found.column, ' ') << "^\n";
+    return true;
+}
+
+/**
+ * `find <text> [from:to]` prints every hit as `@N line:col: <line>`, counted from 1, and keeps
+ * the search so that `show @N` can go back to a hit until the content changes
+ */
+bool Editor::HandleFind(const Command& command) {
+    const auto& args = command.GetArgs();
+    if (args[0].empty()) {
+        Outputer::ErrorLn(command) << "Nothing to find";
+        return false;
+    }
+    int from = 0, to = static_cast<int>(m_Data.lines.size()) - 1;
+    if (args.size() == 2 && !GetAndValidateLineRange(command, args[1], from, to))
+        return false;
+
+    m_LastFind.searcher = CreateScope<SubstringSearcher>(args[0]);
+    m_LastFind.regex.reset();
+    m_LastFind.first = static_cast<size_t>(std::max(0, from));
+    m_LastFind.last = static_cast<size_t>(std::max(0, to));
+    m_LastFind.revision = m_Revision;
+    return ListHits(command);
+}
+
+/**
+ * `find-re <pattern> [from:to]` is `find` for the leftmost-longest matches of a regex, see Regex.h.
+ * compiled patterns are cached by their text, so running the same pattern again does not compile it
+ */
+bool Editor::HandleFindRe(const Command& command) {
+    const auto& args = command.GetArgs();
+    int from = 0, to = static_cast<int>(m_Data.lines.size()) - 1;
+    if (args.size() == 2 && !GetAndValidateLineRange(command, args[1], from, to))
+        return false;
+    Ref<Regex> regex;
+    try {
+        regex = RegexCache::Shared().Get(args[0]);
+    } catch (const std::invalid_argument& e) {
+        Outputer::ErrorLn(command) << "Invalid pattern: " << e.what();
+        return false;
+    }
+
+    m_LastFind.searcher.reset();
+    m_LastFind.regex = regex;
+    m_LastFind.first = static_cast<size_t>(std::max(0, from));
+    m_LastFind.last = static_cast<size_t>(std::max(0, to));
+    m_LastFind.revision = m_Revision;
+    return ListHits(command);
+}
+
+/**
+ * `replace-re <pattern> <replacement> [from:to]` replaces every match, `$0`-`$9` in the replacement
+ * standing for its groups. all replacements are one modification, undone by a single `undo`
+ */
+bool Editor::HandleReplaceRe(const Command& command) {
+    const auto& args = command.GetArgs();
+    int from = 0, to = static_cast<int>(m_Data.lines.size()) - 1;
+    if (args.size() == 3 && !GetAndValidateLineRange(command, args[2], from, to))
+        return false;
+    Ref<Regex> regex;
+    try {
+        regex = RegexCache::Shared().Get(args[0]);
+    } catch (const std::invalid_argument& e) {
+        Outputer::ErrorLn(command) << "Invalid pattern: " << e.what();
+        return false;
+    }
+
+    // the new lines are built first, so that nothing is snapshotted when nothing matches
+    auto replacement = ReplaceRegexMatches(m_Data.lines, std::max(0, from), std::max(0, to), *regex, args[1]);
+    if (replacement.lines.empty()) {
+        Outputer::InfoLn(command) << "0 replacement(s)";
+        return true;
+    }
+    ReplaceLines(replacement);
+    Outputer::InfoLn(command) << replacement.count << " replacement(s) in " << replacement.lines.size() << " line(s)";
+    return true;
+}
+
+void Editor::ApplyReplacement(const Command& command, RegexReplacement replacement) {
+    if (replacement.lines.empty())
+        return;
+    ReplaceLines(replacement);
+    if (m_Journal) {
+        m_Journal->Append(m_FilePath, command.GetLine());
+    }
+    if (m_Data.logMode == LogMode::WithLog) {
+        m_Logger->Log(command);
+    }
+}
+
+void Editor::ReplaceLines(RegexReplacement& replacement) {
+    MODIFICATION_SCOPE;
+    for (auto& [line, text] : replacement.lines) {
+        UnindexLines(line, 1);
+        m_Data.lines[line] = std::move(text);
+        IndexLines(line, 1);
+    }
+}
+
+/**
+ * `diff [file]` prints what changed in the content against the file on disk, its own file by default,
+ * as unified hunks with 3 lines of context. lines are compared by their hashes: the content's are kept
+ * up to date by the edits and the file's are kept until it changes on disk, so diffing again after a
+ * few edits only compares hashes
+ */
+bool Editor::HandleDiff(const Command& command) {
+    constexpr size_t context = 3;
+    constexpr size_t flushSize = 64 * 1024;
+    const auto& path = command.GetArgs().empty() ? m_FilePath : command.GetArgs()[0];
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    const auto diskTime = ec ? -1 : static_cast<int64_t>(time.time_since_epoch().count());
+    const auto size = std::filesystem::file_size(path, ec);
+    const auto diskSize = ec ? -1 : static_cast<int64_t>(size);
+    if (diskTime == -1 || diskSize == -1) {
+        Outputer::ErrorLn(command) << "Cannot read file: " << path;
+        return false;
+    }
+    const MappedFile file(path);
+    const auto text = file.GetView();
+    if (m_DiskLines.path != path || m_DiskLines.time != diskTime || m_DiskLines.size != diskSize
+        || m_DiskLines.lines.textSize != text.size()) {
+        m_DiskLines.lines = TextLines::Split(text);
+        m_DiskLines.path = path;
+        m_DiskLines.time = diskTime;
+        m_DiskLines.size = diskSize;
+    }
+    if (m_HashRevision != m_Revision) {
+        m_LineHashes.resize(m_Data.lines.size());
+        for (size_t line = 0; line < m_Data.lines.size(); line++) {
+            m_LineHashes[line] = HashLine(m_Data.lines[line]);
         }
+        m_HashRevision = m_Revision;
+    }
 
-        if (from < 0 || to < 0 || from >= m_Data.lines.size() || to >= m_Data.lines.size()) {
-            Outputer::ErrorLn(command) << "Range out of bounds";
-            return false;
+    const auto& disk = m_DiskLines.lines;
+    auto matches = DiffLines(disk.hashes, m_LineHashes);
+    matches.push_back(DiffMatch{disk.Size(), m_LineHashes.size(), 0});
+    // the changes between the matches, each a range of removed and a range of added lines
+    struct Change {
+        size_t oldBegin, oldEnd, newBegin, newEnd;
+    };
+    std::vector<Change> changes;
+    size_t oldLine = 0, newLine = 0, removed = 0, added = 0;
+    for (const auto& match : matches) {
+        if (match.oldLine > oldLine || match.newLine > newLine) {
+            changes.push_back(Change{oldLine, match.oldLine, newLine, match.newLine});
+            removed += match.oldLine - oldLine;
+            added += match.newLine - newLine;
         }
-        if (from > to) {
-            std::swap(from, to);
+        oldLine = match.oldLine + match.count;
+        newLine = match.newLine + match.count;
+    }
+    if (changes.empty()) {
+        Outputer::InfoLn(command) << "No changes";
+        return true;
+    }
+
+    std::string out = "--- " + path + "\n+++ " + m_FilePath + " (buffer)\n";
+    for (size_t first = 0; first < changes.size();) {
+        // changes less than two contexts apart share a hunk
+        size_t last = first;
+        while (last + 1 < changes.size() && changes[last + 1].oldBegin - changes[last].oldEnd <= 2 * context) {
+            last++;
         }
+        const auto lead = std::min(context, changes[first].oldBegin);
+        const auto trail = std::min(context, disk.Size() - changes[last].oldEnd);
+        const auto oldBegin = changes[first].oldBegin - lead, oldEnd = changes[last].oldEnd + trail;
+        const auto newBegin = changes[first].newBegin - lead, newEnd = changes[last].newEnd + trail;
+        // an empty range starts at the line before it, like diff -u has it
+        out += "@@ -" + std::to_string(oldEnd > oldBegin ? oldBegin + 1 : oldBegin) + ','
+            + std::to_string(oldEnd - oldBegin) + " +" + std::to_string(newEnd > newBegin ? newBegin + 1 : newBegin)
+            + ',' + std::to_string(newEnd - newBegin) + " @@\n";
+        auto addLines = [&](char prefix, size_t from, size_t to, bool fromDisk) {
+            for (size_t line = from; line < to; line++) {
+                out += prefix;
+                out += fromDisk ? disk.Get(text, line) : std::string_view(m_Data.lines[line]);
+                out += '\n';
+                if (out.size() >= flushSize) {
+                    Outputer::Out() << out;
+                    out.clear();
+                }
+            }
+        };
+        addLines(' ', oldBegin, changes[first].oldBegin, true);
+        for (size_t i = first; i <= last; i++) {
+            addLines('-', changes[i].oldBegin, changes[i].oldEnd, true);
+            addLines('+', changes[i].newBegin, changes[i].newEnd, false);
+            addLines(' ', changes[i].oldEnd, i < last ? changes[i + 1].oldBegin : oldEnd, true);
+        }
+        first = last + 1;
+    }
+    Outputer::Out() << out;
+    Outputer::InfoLn(command) << removed << " line(s) removed, " << added << " added";
+    return true;
+}
+
+// an index is in step before the first change of a modification, and one revision ahead after it
+bool Editor::IsFollowing(uint64_t revision) const {
+    return revision == m_Revision || revision == m_Revision + 1;
+}
+
+void Editor::UnindexLines(size_t first, size_t count) {
+    if (IsFollowing(m_TrigramRevision)) {
+        m_Trigrams.RemoveLines(m_Data.lines, first, count);
     }
+    // the hashes are overwritten by IndexLines, a vector of 10M lines is not shifted twice per edit
+    m_UnhashedLines = count;
+}
 
-    for (int i = std::max(0, from); i < m_Data.lines.size() && i <= to; i++) {
-        Outputer::Out() << m_Data.lines[i] << '\n';
+// the revisions set are the one the MODIFICATION_SCOPE ends with
+void Editor::IndexLines(size_t first, size_t count) {
+    if (IsFollowing(m_TrigramRevision)) {
+        m_Trigrams.AddLines(m_Data.lines, first, count);
+        m_TrigramRevision = m_Revision + 1;
+    }
+    const auto removed = std::exchange(m_UnhashedLines, 0);
+    if (IsFollowing(m_HashRevision)) {
+        if (count > removed) {
+            m_LineHashes.insert(m_LineHashes.begin() + first + removed, count - removed, 0);
+        } else {
+            m_LineHashes.erase(m_LineHashes.begin() + first + count, m_LineHashes.begin() + first + removed);
+        }
+        for (size_t line = first; line < first + count; line++) {
+            m_LineHashes[line] = HashLine(m_Data.lines[line]);
+        }
+        m_HashRevision = m_Revision + 1;
     }
+}
+
+std::vector<TextHit> Editor::SearchIndexed(const TrigramQuery& query, size_t& checkedLines) {
+    std::vector<TextHit> hits;
+    if (m_TrigramRevision == m_Revision && !m_Trigrams.MayContain(query))
+        return hits;
+    EnsureLoaded();
+    if (m_TrigramRevision != m_Revision) {
+        m_Trigrams.Build(m_Data.lines);
+        m_TrigramRevision = m_Revision;
+        if (!m_Trigrams.MayContain(query))
+            return hits;
+    }
+    const auto length = query.searcher.GetNeedle().size();
+    for (size_t line = 0; line < m_Data.lines.size(); line++) {
+        if (!m_Trigrams.MayContain(line, query))
+            continue;
+        checkedLines++;
+        const std::string_view text = m_Data.lines[line];
+        for (auto column = query.searcher.Find(text); column != std::string_view::npos;
+            column = query.searcher.Find(text, column + length)) {
+            hits.push_back(TextHit{line, column, length});
+        }
+    }
+    return hits;
+}
+
+template<typename F>
+size_t Editor::ForEachFoundHit(F&& onHit) {
+    if (m_LastFind.regex)
+        return ForEachRegexHit(m_Data.lines, m_LastFind.first, m_LastFind.last, *m_LastFind.regex, onHit);
+    return ForEachHit(m_Data.lines, m_LastFind.first, m_LastFind.last, *m_LastFind.searcher, onHit);
+}
+
+// prints the hits of the search just kept in m_LastFind
+bool Editor::ListHits(const Command& command) {
+    constexpr size_t flushSize = 64 * 1024;
+    std::string out;
+    size_t number = 0;
+    const auto hits = ForEachFoundHit([&](const TextHit& hit) {
+        out += '@' + std::to_string(++number) + ' ' + std::to_string(hit.line + 1) + ':'
+            + std::to_string(hit.column + 1) + ": ";
+        out += m_Data.lines[hit.line];
+        out += '\n';
+        if (out.size() >= flushSize) {
+            Outputer::Out() << out;
+            out.clear();
+        }
+        return true;
+    });
+    Outputer::Out() << out;
+    Outputer::InfoLn(command) << hits << " hit(s)";
     return true;
 }
 
 bool Editor::HandleAppend(const Command& command) {
     MODIFICATION_SCOPE;
     m_Data.lines.emplace_back(command.GetArgs()[0]);
+    IndexLines(m_Data.lines.size() - 1, 1);
     m_Data.modified = true;
     return true;
 }
@@ -143,7 +793,8 @@ bool Editor::HandleInsert(const Command& command) {
     if (!GetAndValidateLineColRange(command, lineIndex, col)) return false;
     const auto& text = command.GetArgs()[1];
     MODIFICATION_SCOPE;
-    Insert(lineIndex, col, text);
+    UnindexLines(lineIndex, 1);
+    IndexLines(lineIndex, Insert(lineIndex, col, text));
     return true;
 }
 
@@ -164,7 +815,9 @@ bool Editor::HandleDelete(const Command& command) {
         return false;
     }
     MODIFICATION_SCOPE;
+    UnindexLines(lineIndex, 1);
     lineText.erase(lineText.begin() + col, lineText.begin() + col + len);
+    IndexLines(lineIndex, 1);
     return true;
 }
 
@@ -185,8 +838,9 @@ bool Editor::HandleReplace(const Command& command) {
         return false;
     }
     MODIFICATION_SCOPE;
+    UnindexLines(lineIndex, 1);
     lineText.erase(lineText.begin() + col, lineText.begin() + col + len);
-    Insert(lineIndex, col, command.GetArgs()[2]);
+    IndexLines(lineIndex, Insert(lineIndex, col, command.GetArgs()[2]));
     return true;
 }
 
@@ -196,9 +850,10 @@ bool Editor::HandleUndo(const Command& command) {
         return false;
     }
     auto snapshot = CreateDataSnapshot();
-    m_RedoStack.emplace(std::move(snapshot));
-    this->m_Data = *m_UndoStack.top();
-    m_UndoStack.pop();
+    m_RedoStack.push_back(std::move(snapshot));
+    this->m_Data = *m_UndoStack.back();
+    m_UndoStack.pop_back();
+    m_Revision++;
     UpdateTime();
     return true;
 }
@@ -208,9 +863,10 @@ bool Editor::HandleRedo(const Command& command) {
         return false;
     }
     auto snapshot = CreateDataSnapshot();
-    m_UndoStack.emplace(std::move(snapshot));
-    this->m_Data = *m_RedoStack.top();
-    m_RedoStack.pop();
+    m_UndoStack.push_back(std::move(snapshot));
+    this->m_Data = *m_RedoStack.back();
+    m_RedoStack.pop_back();
+    m_Revision++;
     UpdateTime();
     return true;
 }
@@ -238,7 +894,26 @@ bool Editor::GetAndValidateLineColRange(const Command& command, int& lineIndex,
     return true;
 }
 
-void Editor::Insert(int lineIndex, int col, const std::string& raw) {
+bool Editor::GetAndValidateLineRange(const Command& command, const std::string& rangeText, int& from, int& to) const {
+    try {
+        const auto range = ParseRange(rangeText);
+        from = range.first - 1;
+        to = range.second - 1;
+    } catch (const std::exception&) {
+        Outputer::ErrorLn(command) << "Invalid range format";
+        return false;
+    }
+    if (from < 0 || to < 0 || from >= m_Data.lines.size() || to >= m_Data.lines.size()) {
+        Outputer::ErrorLn(command) << "Range out of bounds";
+        return false;
+    }
+    if (from > to) {
+        std::swap(from, to);
+    }
+    return true;
+}
+
+size_t Editor::Insert(int lineIndex, int col, const std::string& raw) {
     auto inserted = ParseLineBreaks(raw);
     const auto lineText = m_Data.lines[lineIndex];
     const auto prefix = lineText.substr(0, col), suffix = lineText.substr(col);
@@ -261,6 +936,7 @@ void Editor::Insert(int lineIndex, int col, const std::string& raw) {
         m_Data.lines.erase(m_Data.lines.begin() + lineIndex);
         m_Data.lines.insert(m_Data.lines.begin() + lineIndex, lineReplacement.begin(), lineReplacement.end());
     }
+    return inserted.size();
 }
 
 Scope<EditorData> Editor::CreateDataSnapshot() {
@@ -268,17 +944,22 @@ Scope<EditorData> Editor::CreateDataSnapshot() {
 }
 
 void Editor::Save() {
-    std::ofstream out(m_FilePath);
-    if (!out.is_open()) {
-        throw std::runtime_error("Could not open file: " + m_FilePath);
+    EnsureLoaded();
+    WriteEditorFile(m_FilePath, m_Data.lines);
+    MarkSaved();
+    // a session image written before must not win over the file after a crash
+    if (m_Journal && !m_Journal->Commit()) {
+        Outputer::InfoLn() << "Warning: the journal could not record the save of `" << m_FilePath << "`";
     }
-    for (const auto& line : m_Data.lines) {
-        out << line << std::endl;
-    }
-    out.close();
-    m_Data.modified = false;
     Outputer::InfoLn() << "File saved: " << m_FilePath;
 }
+
+void Editor::MarkSaved() {
+    m_Data.modified = false;
+    if (m_Journal) {
+        m_Journal->MarkSaved(m_FilePath);
+    }
+}
 void Editor::AskSaving(){
     if (m_Data.modified) {
         Outputer::InfoLn() << "File `" << m_FilePath << "` has been modified. Save before Closing?(y/n)";
@@ -292,4 +973,5 @@ void Editor::AskSaving(){
 
 void Editor::UpdateTime() {
     m_LastTime = std::chrono::system_clock::now();
+    Touch();
 }
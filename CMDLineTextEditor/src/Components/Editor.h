@@ -2,54 +2,143 @@
 
 #pragma once
 #include <chrono>
-#include <stack>
+#include <cstdint>
 #include <string>
 #include <vector>
 
 #include "Command.h"
 #include "Core.h"
 #include "Logging.h"
+#include "EditJournal.h"
 #include "CommandExecuting.h"
+#include "MruList.h"
+#include "TextSearch.h"
+#include "Regex.h"
+#include "TrigramIndex.h"
+#include "LineDiff.h"
 
 std::pair<int, int> ParseRange(const std::string& range);
 
 std::vector<std::string> ParseLineBreaks(const std::string& line, const std::string& seperator = "\\n");
 
+// absolute, normalized and with symlinks resolved as far as the path exists
+std::string CanonicalizePath(const std::string& path);
+
+// short file name derived from a canonical path, for files kept on behalf of an editor
+std::string GetPathHashName(const std::string& canonicalPath);
+
 enum class LogMode{
     None,
     WithLog,
     NoLog,
 };
 
+// what reading a file for an editor yields, computed without touching any editor
+// so that many files can be read on worker threads
+struct EditorFileData {
+    std::string canonicalPath;
+    std::vector<std::string> lines;
+    bool created = false; // the file did not exist and was created empty
+};
+
+// creates the file and its parent directories when missing, throws when that fails
+EditorFileData ReadEditorFile(const std::string& filePath);
+
+// writes the lines to a temporary file next to `filePath` and renames it over the file,
+// so a failed write never leaves a half written file. a symbolic link is followed and kept, the
+// mode and owner of the file are carried over, and the file and its directory are synced before
+// and after the rename. returns the bytes written, throws on failure
+uintmax_t WriteEditorFile(const std::string& filePath, const std::vector<std::string>& lines);
+
 struct EditorData {
     bool modified = false;
     std::vector<std::string> lines;
     LogMode logMode = LogMode::None;
 };
 
-class Editor : public CommandExecutor {
+// everything needed to bring an editor back without reading its file
+struct EditorSession {
+    std::string path;
+    int64_t diskTime = -1; // last write time and size of the file when captured
+    int64_t diskSize = -1;
+    EditorData data;
+    std::vector<EditorData> undo; // bottom of the stack first
+    std::vector<EditorData> redo;
+};
+
+class Editor : public CommandExecutor, public MruHook<Editor> {
 public:
     Editor();
+    ~Editor() override;
     explicit Editor(const std::string& filePathText, LogMode logMode = LogMode::None);
+    Editor(const std::string& filePathText, EditorFileData fileData, LogMode logMode = LogMode::None);
+    // an editor that reads its file only when the content is first needed
+    static Ref<Editor> CreateUnloaded(const std::string& filePathText, LogMode logMode, bool modified);
     void Handle(const Command& command) override;
+    // applies a journaled command again, without logging or journaling it
+    bool Replay(const Command& command);
+    // applies a journaled change again, false when it does not fit the buffer
+    bool Replay(const JournalChange& change);
 
     void Save();
+    // the content was written by someone else, e.g. a save-all worker
+    void MarkSaved();
     void UpdateTime();
     void AskSaving();
+    // reads the file, or the swap file after Evict, if that did not happen yet.
+    // throws when it cannot be opened or created
+    void EnsureLoaded();
+    // the same with content read elsewhere, ignored when loaded or evicted
+    void LoadFrom(EditorFileData fileData);
+    bool IsLoaded() const { return m_Loaded; }
+    // moves content and history to a swap file in data/.swap and frees them with everything built
+    // from them but the trigram index, false when not loaded or the swap file could not be written
+    bool Evict();
+    bool IsEvicted() const { return !m_SwapPath.empty(); }
+    // the content of an evicted editor, as written by SessionImage::SerializeContent
+    const std::string& GetSwapPath() const { return m_SwapPath; }
+    // estimated heap bytes of content and history, recounted only after changes, and of the
+    // indexes, which are counted while evicted as well
+    size_t GetResidentBytes();
+    // frees the trigram index, it is built again by the next search
+    void DropIndex();
+    uintmax_t GetSwapBytes() const;
+    // copies content and history, the editor has to be loaded
+    EditorSession CaptureSession() const;
+    void RestoreSession(EditorSession session);
+    // replaces the whole content as one undoable modification
+    void ReplaceContent(std::vector<std::string> lines);
+    // applies what ReplaceRegexMatches computed from the current lines as one modification,
+    // journaled and logged as `command`, which has to make the same changes when replayed
+    void ApplyReplacement(const Command& command, RegexReplacement replacement);
+    // hits of the query's needle on the lines the trigram index does not rule out. the index is built
+    // here when it is missing or behind, and an editor it rules out entirely is not loaded.
+    // `checkedLines` is increased by the lines searched
+    std::vector<TextHit> SearchIndexed(const TrigramQuery& query, size_t& checkedLines);
+    // changes whenever the content does, including undo and redo
+    uint64_t GetRevision() const { return m_Revision; }
 
     const std::string& GetFilePath() { return m_FilePath; }
+    const std::string& GetCanonicalPath() const { return m_CanonicalPath; }
     const std::chrono::time_point<std::chrono::system_clock>& GetLastTime() const { return m_LastTime; }
     LogMode GetLogMode() const { return m_Data.logMode; }
     const Ref<Logger>& GetLogger() const { return m_Logger; }
     void SetLogMode(LogMode m) { m_Data.logMode = m; }
+    const LogPolicy& GetLogPolicy() const { return m_Logger->GetPolicy(); }
+    void SetLogPolicy(const LogPolicy& policy) { m_Logger->SetPolicy(policy); }
     bool IsModified() const { return m_Data.modified; }
     void SetModified(bool m) { m_Data.modified = m; }
-    const std::vector<std::string>& GetLines() const { return m_Data.lines; };
+    void SetJournal(const Ref<EditJournal>& journal) { m_Journal = journal; }
+    const std::vector<std::string>& GetLines() { EnsureLoaded(); return m_Data.lines; };
 
 protected:
     void RegisterCommandHandlingStrategies() override;
 private:
     bool HandleShow   (const Command& command);
+    bool HandleFind   (const Command& command);
+    bool HandleFindRe (const Command& command);
+    bool HandleReplaceRe(const Command& command);
+    bool HandleDiff   (const Command& command);
     bool HandleAppend (const Command& command);
     bool HandleInsert (const Command& command);
     bool HandleDelete (const Command& command);
@@ -57,18 +146,60 @@ private:
     bool HandleUndo   (const Command& command);
     bool HandleRedo   (const Command& command);
     friend class EditorModificationScope;
+    void InitWithPath(const std::string& filePathText, std::string canonicalPath);
+    void Load(EditorFileData fileData, LogMode logMode);
     bool GetAndValidateLineColRange(const Command& command, int& lineIndex, int& col) const;
-    void Insert(int lineIndex, int col, const std::vector<std::string>::value_type& raw);
+    bool GetAndValidateLineRange(const Command& command, const std::string& rangeText, int& from, int& to) const;
+    bool ShowHit(const Command& command, const std::string& hitText);
+    bool ListHits(const Command& command);
+    template<typename F>
+    size_t ForEachFoundHit(F&& onHit);
+    // returns the number of lines the line at `lineIndex` became
+    size_t Insert(int lineIndex, int col, const std::vector<std::string>::value_type& raw);
+    // the trigram index and the line hashes follow the edit handlers: they take lines out before changing
+    // them and put them back after, inside their MODIFICATION_SCOPE. other changes, like undo, leave them behind
+    bool IsFollowing(uint64_t revision) const;
+    void UnindexLines(size_t first, size_t count);
+    void IndexLines(size_t first, size_t count);
+    void ReplaceLines(RegexReplacement& replacement);
     Scope<EditorData> CreateDataSnapshot();
 
 private:
     CommandDispatcher<Editor> m_Dispatcher;
-    std::stack<Scope<EditorData>> m_UndoStack;
-    std::stack<Scope<EditorData>> m_RedoStack;
+    // the top of a stack is its back
+    std::vector<Scope<EditorData>> m_UndoStack;
+    std::vector<Scope<EditorData>> m_RedoStack;
     std::string m_FilePath;
+    std::string m_CanonicalPath;
     EditorData m_Data;
+    bool m_Loaded = false;
+    uint64_t m_Revision = 0;
+    uint64_t m_CountedRevision = UINT64_MAX;
+    size_t m_ResidentBytes = 0;
+    std::string m_SwapPath; // set while evicted
+    // the last `find` or `find-re`, for `show @N`. hits are found again on demand instead of being kept
+    struct {
+        Scope<SubstringSearcher> searcher;
+        Ref<Regex> regex; // shared with RegexCache::Shared()
+        size_t first = 0;
+        size_t last = 0;
+        uint64_t revision = 0;
+    } m_LastFind;
+    TrigramIndex m_Trigrams; // kept through eviction, so that a search can rule the editor out without loading it
+    uint64_t m_TrigramRevision = UINT64_MAX; // the revision m_Trigrams describes
+    std::vector<uint64_t> m_LineHashes; // HashLine of every line, for `diff`
+    uint64_t m_HashRevision = UINT64_MAX;
+    size_t m_UnhashedLines = 0; // taken out by UnindexLines, not yet put back
+    // the file as `diff` last split it, split again only when its time or size changed
+    struct {
+        std::string path;
+        int64_t time = -1;
+        int64_t size = -1;
+        TextLines lines;
+    } m_DiskLines;
     std::chrono::time_point<std::chrono::system_clock> m_LastTime;
     Ref<Logger> m_Logger;
+    Ref<EditJournal> m_Journal;
     // using CommandStrategy = bool (Editor::*)(const Command&);
     // static const std::unordered_map<Command::Type, CommandStrategy> s_HandlerMethods;
 };
@@ -78,10 +209,11 @@ public:
     explicit EditorModificationScope(Editor* editor)
         : m_Editor(editor), m_Snapshot(editor->CreateDataSnapshot()) {}
     ~EditorModificationScope() {
-        m_Editor->m_RedoStack = {};
+        m_Editor->m_RedoStack.clear();
         m_Editor->m_Data.modified = true;
+        m_Editor->m_Revision++;
         m_Editor->UpdateTime();
-        m_Editor->m_UndoStack.push(std::move(m_Snapshot));
+        m_Editor->m_UndoStack.push_back(std::move(m_Snapshot));
     }
 private:
     Editor* m_Editor;
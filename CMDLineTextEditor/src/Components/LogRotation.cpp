@@ -0,0 +1,210 @@
+#include "LogRotation.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include "Timestamp.h"
+
+namespace {
+    const char* const s_CompactHeader = "#compact-log 1";
+    const std::string s_SessionPrefix = "session start at ";
+
+    // days since 1970-01-01 of a proleptic gregorian date
+    int64_t DaysFromCivil(int64_t y, int64_t m, int64_t d) {
+        y -= m <= 2;
+        const int64_t era = (y >= 0 ? y : y - 399) / 400;
+        const int64_t yoe = y - era * 400;
+        const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    void CivilFromDays(int64_t days, int64_t& y, int64_t& m, int64_t& d) {
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const int64_t doe = days - era * 146097;
+        const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const int64_t mp = (5 * doy + 2) / 153;
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp + (mp < 10 ? 3 : -9);
+        y = yoe + era * 400 + (m <= 2);
+    }
+
+    bool ReadNumber(const std::string& text, size_t pos, size_t width, int64_t& value) {
+        value = 0;
+        for (size_t i = pos; i < pos + width; i++) {
+            if (text[i] < '0' || text[i] > '9')
+                return false;
+            value = value * 10 + (text[i] - '0');
+        }
+        return true;
+    }
+
+    // a signed decimal delta filling text[pos, end), as written by CompactLogSegment
+    bool ReadDelta(const std::string& text, size_t pos, size_t end, int64_t& value) {
+        const bool negative = pos < end && text[pos] == '-';
+        pos += negative ? 1 : 0;
+        if (pos == end || end - pos > 18 || !ReadNumber(text, pos, end - pos, value))
+            return false;
+        value = negative ? -value : value;
+        return true;
+    }
+
+    // the timestamp at `pos` as seconds, read as a plain calendar time
+    bool ParseTimestamp(const std::string& text, size_t pos, int64_t& seconds) {
+        if (text.size() < pos + TimestampLength || text[pos + 8] != ' '
+            || text[pos + 11] != ':' || text[pos + 14] != ':')
+            return false;
+        int64_t y, mo, d, h, mi, s;
+        if (!ReadNumber(text, pos, 4, y) || !ReadNumber(text, pos + 4, 2, mo) || !ReadNumber(text, pos + 6, 2, d)
+            || !ReadNumber(text, pos + 9, 2, h) || !ReadNumber(text, pos + 12, 2, mi) || !ReadNumber(text, pos + 15, 2, s))
+            return false;
+        if (mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 59)
+            return false;
+        seconds = DaysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s;
+        return true;
+    }
+
+    std::string FormatSeconds(int64_t seconds) {
+        int64_t days = seconds / 86400, rest = seconds % 86400;
+        if (rest < 0) {
+            rest += 86400;
+            days--;
+        }
+        int64_t y, m, d;
+        CivilFromDays(days, y, m, d);
+        char text[TimestampLength + 1];
+        std::snprintf(text, sizeof(text), "%04d%02d%02d %02d:%02d:%02d",
+            static_cast<int>(y), static_cast<int>(m), static_cast<int>(d),
+            static_cast<int>(rest / 3600), static_cast<int>(rest / 60 % 60), static_cast<int>(rest % 60));
+        return {text, TimestampLength};
+    }
+}
+
+int64_t GetLogClock(std::chrono::time_point<std::chrono::system_clock> t) {
+    char text[TimestampLength];
+    FormatTimestamp(t, text);
+    int64_t seconds = 0;
+    ParseTimestamp(std::string(text, TimestampLength), 0, seconds);
+    return seconds;
+}
+
+bool ReadLogStart(const std::string& path, int64_t& seconds) {
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    if (!in.is_open() || !std::getline(in, line))
+        return false;
+    // records of a journal are prefixed by `<id>\t<path>\t`
+    const auto tab = line.rfind('\t');
+    const auto record = tab == std::string::npos ? 0 : tab + 1;
+    if (line.compare(record, s_SessionPrefix.size(), s_SessionPrefix) == 0)
+        return ParseTimestamp(line, record + s_SessionPrefix.size(), seconds);
+    return ParseTimestamp(line, record, seconds);
+}
+
+std::string GetLogSegmentPath(const std::string& path, int index, bool compacted) {
+    return path + '.' + std::to_string(index) + (compacted ? ".compact" : "");
+}
+
+void RotateLogFile(const std::string& path, const LogRotationPolicy& policy) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    const int retain = policy.retainCount < 0 ? 0 : policy.retainCount;
+    for (const bool compacted : {false, true}) {
+        fs::remove(GetLogSegmentPath(path, retain, compacted), ec);
+    }
+    for (int i = retain - 1; i >= 1; i--) {
+        for (const bool compacted : {false, true}) {
+            const auto from = GetLogSegmentPath(path, i, compacted);
+            if (fs::exists(from, ec)) {
+                fs::rename(from, GetLogSegmentPath(path, i + 1, compacted), ec);
+            }
+        }
+    }
+    if (retain > 0) {
+        fs::rename(path, GetLogSegmentPath(path, 1, false), ec);
+    } else {
+        fs::remove(path, ec);
+    }
+
+    for (int i = policy.plainCount + 1; i <= retain; i++) {
+        const auto plain = GetLogSegmentPath(path, i, false);
+        if (fs::exists(plain, ec) && CompactLogSegment(plain, GetLogSegmentPath(path, i, true))) {
+            fs::remove(plain, ec);
+        }
+    }
+}
+
+bool CompactLogSegment(const std::string& plainPath, const std::string& compactPath) {
+    std::ifstream in(plainPath, std::ios::binary);
+    std::ofstream out(compactPath, std::ios::binary | std::ios::trunc);
+    if (!in.is_open() || !out.is_open())
+        return false;
+    out << s_CompactHeader << '\n';
+    int64_t last = 0;
+    std::string lastCommand;
+    for (std::string line; std::getline(in, line); ) {
+        int64_t seconds;
+        if (line.compare(0, s_SessionPrefix.size(), s_SessionPrefix) == 0
+            && line.size() == s_SessionPrefix.size() + TimestampLength
+            && ParseTimestamp(line, s_SessionPrefix.size(), seconds)) {
+            out << 'S' << seconds - last << '\n';
+            last = seconds;
+        } else if (line.size() > TimestampLength + 1 && line[TimestampLength] == ' '
+            && ParseTimestamp(line, 0, seconds)) {
+            const auto command = line.substr(TimestampLength + 1);
+            out << 'T' << seconds - last << '\t';
+            if (command != lastCommand) {
+                out << command;
+                lastCommand = command;
+            }
+            out << '\n';
+            last = seconds;
+        } else {
+            out << 'R' << line << '\n';
+        }
+    }
+    return static_cast<bool>(out.flush());
+}
+
+std::string ExpandLogSegment(const std::string& compactPath) {
+    std::ifstream in(compactPath, std::ios::binary);
+    std::string header;
+    if (!in.is_open() || !std::getline(in, header) || header != s_CompactHeader)
+        return {};
+    std::stringstream result;
+    int64_t last = 0;
+    std::string lastCommand;
+    for (std::string line; std::getline(in, line); ) {
+        if (line.empty())
+            continue;
+        const auto body = line.substr(1);
+        int64_t delta;
+        switch (line[0]) {
+        case 'S':
+            if (!ReadDelta(body, 0, body.size(), delta))
+                return {};
+            last += delta;
+            result << s_SessionPrefix << FormatSeconds(last) << '\n';
+            break;
+        case 'T': {
+            const auto tab = body.find('\t');
+            if (!ReadDelta(body, 0, std::min(tab, body.size()), delta))
+                return {};
+            last += delta;
+            if (tab != std::string::npos && tab + 1 < body.size()) {
+                lastCommand = body.substr(tab + 1);
+            }
+            result << FormatSeconds(last) << ' ' << lastCommand << '\n';
+            break;
+        }
+        default:
+            result << body << '\n';
+        }
+    }
+    return result.str();
+}
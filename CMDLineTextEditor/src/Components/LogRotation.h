@@ -0,0 +1,32 @@
+// LogRotation.h
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+struct LogRotationPolicy {
+    uintmax_t maxBytes = 1 << 20;           // rotate once the live file would grow past this, 0 disables
+    std::chrono::hours maxAge{24 * 7};      // rotate a live file older than this, 0 disables
+    int retainCount = 5;                    // rotated segments kept next to the live file
+    int plainCount = 1;                     // newest rotated segments left as text, older ones are compacted
+};
+
+// `<log>` becomes `<log>.1`, `<log>.1` becomes `<log>.2` and so on. segments beyond
+// the retain count are removed and segments beyond the plain count are compacted.
+void RotateLogFile(const std::string& path, const LogRotationPolicy& policy);
+
+std::string GetLogSegmentPath(const std::string& path, int index, bool compacted);
+
+// a time as seconds of its local calendar date and time, the scale the records of a log are written in
+int64_t GetLogClock(std::chrono::time_point<std::chrono::system_clock> t);
+// the time of the first record of a log, i.e. when the segment was started, on the scale of
+// GetLogClock. false when the log does not start with a timestamped record
+bool ReadLogStart(const std::string& path, int64_t& seconds);
+
+// rewrites a plain segment into the compact format: timestamps become deltas
+// in seconds and a command repeating the previous one is left out
+bool CompactLogSegment(const std::string& plainPath, const std::string& compactPath);
+// reads a compacted segment back into the plain log text, empty when the file is not a
+// well formed compacted segment
+std::string ExpandLogSegment(const std::string& compactPath);
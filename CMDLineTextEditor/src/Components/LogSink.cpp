@@ -0,0 +1,229 @@
+#include "LogSink.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+#include "Outputer.h"
+
+LogSink::~LogSink() {
+    try {
+        Flush();
+    }
+    catch (const std::exception& e) {
+        Outputer::InfoLn() << "Failed to flush logs: " << e.what();
+    }
+}
+
+LogSink& LogSink::Get() {
+    static LogSink sink;
+    return sink;
+}
+
+int LogSink::Register(const std::string& path, const std::string& header) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const int id = m_NextId++;
+    m_Sources[id] = Source{path, header, false, {}};
+    return id;
+}
+
+void LogSink::Unregister(int id) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    FlushLocked();
+    const auto it = m_Sources.find(id);
+    if (it == m_Sources.end())
+        return;
+    const auto path = it->second.path;
+    m_Sources.erase(it);
+    if (m_Target == Target::Journal)
+        return;
+    for (const auto& [otherId, source] : m_Sources) {
+        if (source.path == path)
+            return;
+    }
+    CloseStream(path);
+}
+
+void LogSink::Append(int id, std::string text) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const auto source = m_Sources.find(id);
+    if (source == m_Sources.end())
+        return;
+    m_Pending.push_back(Record{id, source->second.records.size()});
+    source->second.records.push_back(std::move(text));
+    if (m_Pending.size() >= m_Stuck + m_GroupSize) {
+        FlushLocked();
+    }
+}
+
+void LogSink::Flush() {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    FlushLocked();
+}
+
+std::string LogSink::GetBuffer(int id) const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::string result;
+    const auto it = m_Sources.find(id);
+    if (it == m_Sources.end())
+        return result;
+    result += it->second.header;
+    result += '\n';
+    for (const auto& text : it->second.records) {
+        result += text;
+        result += '\n';
+    }
+    return result;
+}
+
+void LogSink::SetTarget(Target target, const std::string& journalPath) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    FlushLocked();
+    m_OpenFiles.clear();
+    m_Target = target;
+    m_JournalPath = journalPath;
+}
+
+void LogSink::SetGroupSize(size_t records) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_GroupSize = records;
+}
+
+void LogSink::SetMaxOpenFiles(size_t files) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_MaxOpenFiles = files == 0 ? 1 : files;
+}
+
+void LogSink::SetRotationPolicy(const LogRotationPolicy& policy) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_RotationPolicy = policy;
+}
+
+size_t LogSink::GetOpenFileCount() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_OpenFiles.size();
+}
+
+void LogSink::FlushLocked() {
+    if (m_Pending.empty())
+        return;
+    // bucket the pending records by output file, keeping their order
+    struct Batch {
+        std::string path;
+        std::string content;
+        std::vector<Record> records;
+        std::vector<int> headers; // sources whose header starts in this batch
+    };
+    std::vector<Batch> batches;
+    std::unordered_map<std::string, size_t> batchOfPath;
+    for (const auto& record : m_Pending) {
+        const auto source = m_Sources.find(record.id);
+        if (source == m_Sources.end())
+            continue;
+        const auto& path = m_Target == Target::Journal ? m_JournalPath : source->second.path;
+        auto [it, inserted] = batchOfPath.try_emplace(path, batches.size());
+        if (inserted) {
+            batches.push_back(Batch{path, std::string(), {}, {}});
+        }
+        auto& batch = batches[it->second];
+        std::string tag;
+        if (m_Target == Target::Journal) {
+            tag = std::to_string(record.id) + '\t' + source->second.path + '\t';
+        }
+        if (!source->second.headerWritten) {
+            batch.content += tag + source->second.header + '\n';
+            batch.headers.push_back(record.id);
+            source->second.headerWritten = true;
+        }
+        batch.content += tag + source->second.records[record.index] + '\n';
+        batch.records.push_back(record);
+    }
+    m_Pending.clear();
+
+    for (auto& batch : batches) {
+        try {
+            auto* file = &AcquireFile(batch.path);
+            if (ShouldRotate(*file, batch.content.size())) {
+                CloseStream(batch.path);
+                RotateLogFile(batch.path, m_RotationPolicy);
+                file = &AcquireFile(batch.path);
+            }
+            file->out << batch.content;
+            file->out.flush();
+            if (!file->out) {
+                CloseStream(batch.path);
+                throw std::runtime_error("Could not write file: " + batch.path);
+            }
+            file->size += batch.content.size();
+            m_FailedPaths.erase(batch.path);
+        } catch (const std::exception& e) {
+            // kept for the next flush, the error is reported until the file works again
+            if (m_FailedPaths.insert(batch.path).second) {
+                Outputer::InfoLn() << "Failed to write log: " << e.what();
+            }
+            for (const auto id : batch.headers) {
+                m_Sources[id].headerWritten = false;
+            }
+            m_Pending.insert(m_Pending.end(), batch.records.begin(), batch.records.end());
+        }
+    }
+    // records that could not be written do not count towards the next group
+    m_Stuck = m_Pending.size();
+}
+
+bool LogSink::ShouldRotate(const OpenFile& file, size_t incoming) const {
+    if (file.size == 0)
+        return false;
+    if (m_RotationPolicy.maxBytes > 0 && file.size + incoming > m_RotationPolicy.maxBytes)
+        return true;
+    return IsAged(file.createdAt);
+}
+
+bool LogSink::IsAged(int64_t createdAt) const {
+    const auto maxAge = std::chrono::duration_cast<std::chrono::seconds>(m_RotationPolicy.maxAge).count();
+    return maxAge > 0 && GetLogClock(std::chrono::system_clock::now()) - createdAt > maxAge;
+}
+
+LogSink::OpenFile& LogSink::AcquireFile(const std::string& path) {
+    for (auto it = m_OpenFiles.begin(); it != m_OpenFiles.end(); ++it) {
+        if (it->path == path) {
+            m_OpenFiles.splice(m_OpenFiles.begin(), m_OpenFiles, it);
+            return m_OpenFiles.front();
+        }
+    }
+    std::filesystem::path fp(path);
+    if (!fp.parent_path().empty()) {
+        if (!std::filesystem::exists(fp.parent_path())) {
+            std::filesystem::create_directories(fp.parent_path());
+        }
+        if (!std::filesystem::is_directory(fp.parent_path())) {
+            throw std::runtime_error("The parent directory of `" + path + "` is an existing file");
+        }
+    }
+    std::error_code ec;
+    uintmax_t size = std::filesystem::exists(fp, ec) ? std::filesystem::file_size(fp, ec) : 0;
+    if (ec) {
+        size = 0;
+    }
+    // the age of a segment counts from its first record, not from when it was last opened,
+    // as the least recently used files are closed and reopened all the time
+    const auto now = GetLogClock(std::chrono::system_clock::now());
+    int64_t createdAt = now;
+    if (size > 0 && ReadLogStart(path, createdAt) && IsAged(createdAt)) {
+        RotateLogFile(path, m_RotationPolicy);
+        size = 0;
+        createdAt = now;
+    }
+    while (m_OpenFiles.size() >= m_MaxOpenFiles) {
+        m_OpenFiles.pop_back();
+    }
+    m_OpenFiles.push_front(OpenFile{path, std::ofstream(path, std::ios::app | std::ios::out), size, createdAt});
+    if (!m_OpenFiles.front().out.is_open()) {
+        m_OpenFiles.pop_front();
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    return m_OpenFiles.front();
+}
+
+void LogSink::CloseStream(const std::string& path) {
+    m_OpenFiles.remove_if([&path](const OpenFile& file) { return file.path == path; });
+}
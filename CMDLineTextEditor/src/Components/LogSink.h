@@ -0,0 +1,85 @@
+// LogSink.h
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "LogRotation.h"
+
+// shared by every Logger, records are kept per id handed out in Register and released by Unregister
+class LogSink {
+public:
+    enum class Target {
+        PerFile, // each logger appends to its own file
+        Journal, // every record goes to one journal file, prefixed by its tag
+    };
+
+    LogSink() = default;
+    ~LogSink();
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    static LogSink& Get();
+
+    int Register(const std::string& path, const std::string& header);
+    // flushes the records of the id, closes its file if nobody else uses it
+    void Unregister(int id);
+    void Append(int id, std::string text);
+    // group commit: writes every pending record, opening each file at most once.
+    // records of a file that cannot be written stay pending, the failure is reported once
+    void Flush();
+
+    std::string GetBuffer(int id) const;
+
+    void SetTarget(Target target, const std::string& journalPath = "data/.log-journal");
+    void SetGroupSize(size_t records);
+    void SetMaxOpenFiles(size_t files);
+    void SetRotationPolicy(const LogRotationPolicy& policy);
+    size_t GetOpenFileCount() const;
+
+private:
+    struct Source {
+        std::string path;
+        std::string header;
+        bool headerWritten = false;
+        std::vector<std::string> records; // the whole session of this id, shown by log-show
+    };
+    // a record not yet on disk, in the order of Append across all ids
+    struct Record {
+        int id;
+        size_t index;
+    };
+    struct OpenFile {
+        std::string path;
+        std::ofstream out;
+        uintmax_t size = 0;
+        int64_t createdAt = 0; // time of the first record, on the scale of GetLogClock
+    };
+
+    void FlushLocked();
+    OpenFile& AcquireFile(const std::string& path);
+    bool ShouldRotate(const OpenFile& file, size_t incoming) const;
+    bool IsAged(int64_t createdAt) const;
+    void CloseStream(const std::string& path);
+
+private:
+    mutable std::mutex m_Mutex;
+    int m_NextId = 0;
+    std::unordered_map<int, Source> m_Sources;
+    std::vector<Record> m_Pending;
+    size_t m_Stuck = 0;              // pending records a flush failed to write
+    std::unordered_set<std::string> m_FailedPaths; // reported once until written again
+    size_t m_GroupSize = 64;
+    size_t m_MaxOpenFiles = 8;
+    std::list<OpenFile> m_OpenFiles; // most recently used first
+    Target m_Target = Target::PerFile;
+    std::string m_JournalPath = "data/.log-journal";
+    LogRotationPolicy m_RotationPolicy;
+};
@@ -1,27 +1,65 @@
 #include "Logging.h"
 
-#include <filesystem>
-#include <fstream>
-
 #include "Outputer.h"
+#include "Timestamp.h"
 
 std::string GetTimestamp(std::chrono::time_point<std::chrono::system_clock> t) {
-    const auto timeTick = std::chrono::system_clock::to_time_t(t);
+    char text[TimestampLength];
+    FormatTimestamp(t, text);
+    return {text, TimestampLength};
+}
 
-    const std::tm tm = *std::localtime(&timeTick);
+bool LogPolicy::Parse(const std::string& text, LogPolicy& policy) {
+    const auto colon = text.find(':');
+    const auto name = text.substr(0, colon);
+    int value = 0;
+    if (colon != std::string::npos) {
+        try {
+            value = std::stoi(text.substr(colon + 1));
+        } catch (const std::exception&) {
+            return false;
+        }
+        if (value <= 0)
+            return false;
+    }
+    if (name == "all" && colon == std::string::npos) {
+        policy.level = Level::All;
+    } else if (name == "mutating" && colon == std::string::npos) {
+        policy.level = Level::Mutating;
+    } else if (name == "sample" && colon != std::string::npos) {
+        policy.level = Level::Sampled;
+        policy.sampleRate = value;
+    } else if (name == "counters" && colon != std::string::npos) {
+        policy.level = Level::Counters;
+        policy.interval = std::chrono::seconds(value);
+    } else {
+        return false;
+    }
+    return true;
+}
 
-    std::stringstream ss;
-    ss << std::put_time(&tm, "%Y%m%d %H:%M:%S");
-    return ss.str();
+std::string LogPolicy::ToString() const {
+    switch (level) {
+    case Level::Mutating:
+        return "mutating";
+    case Level::Sampled:
+        return "sample:" + std::to_string(sampleRate);
+    case Level::Counters:
+        return "counters:" + std::to_string(interval.count());
+    default:
+        return "all";
+    }
 }
 
-Logger::Logger(const std::string& logOutPath) {
-    m_FilePath = logOutPath;
-    buffer << "session start at " << GetTimestamp() << std::endl;
+Logger::Logger(const std::string& logOutPath, LogSink& sink)
+    : m_FilePath(logOutPath), m_Sink(sink)
+{
+    m_Id = m_Sink.Register(m_FilePath, "session start at " + GetTimestamp());
 }
 Logger::~Logger() {
     try {
-        Save();
+        FlushCounters(std::chrono::system_clock::now());
+        m_Sink.Unregister(m_Id);
     }
     catch (const std::exception& e) {
         Outputer::InfoLn() << "Failed to save" << this->m_FilePath << ": " << e.what();
@@ -29,33 +67,69 @@ Logger::~Logger() {
 }
 
 void Logger::Log(const Command& command) {
+    switch (m_Policy.level) {
+    case LogPolicy::Level::Mutating:
+        if (!command.IsMutating())
+            return;
+        break;
+    case LogPolicy::Level::Sampled:
+        if (command.GetType() == Command::Type::Show && m_ShowsSeen++ % m_Policy.sampleRate != 0)
+            return;
+        break;
+    case LogPolicy::Level::Counters:
+        if (m_Counters.empty()) {
+            m_IntervalStart = command.GetTime();
+        }
+        m_Counters[command.GetVerb()]++;
+        if (command.GetTime() - m_IntervalStart >= m_Policy.interval) {
+            FlushCounters(command.GetTime());
+        }
+        return;
+    default:
+        break;
+    }
+    Write(command.GetTime(), command.GetLine());
+}
 
-    buffer << GetTimestamp(command.GetTime()) << ' ' << command.GetLine() << std::endl;
-    buffer.flush();
+void Logger::SetPolicy(const LogPolicy& policy) {
+    FlushCounters(std::chrono::system_clock::now());
+    m_Policy = policy;
+    m_ShowsSeen = 0;
 }
 
-void Logger::Show() const {
-    Outputer::Out() << buffer.str();
+void Logger::Write(std::chrono::time_point<std::chrono::system_clock> t, const std::string& text) {
+    char timestamp[TimestampLength];
+    FormatTimestamp(t, timestamp);
+    std::string record;
+    record.reserve(TimestampLength + 1 + text.size());
+    record.append(timestamp, TimestampLength).append(1, ' ').append(text);
+    m_Sink.Append(m_Id, std::move(record));
 }
 
-void Logger::Save() {
-    if (!m_LoggingOut.is_open()) {
-        std::filesystem::path fp(m_FilePath);
-        if (!fp.parent_path().empty()) {
-            if (!std::filesystem::exists(fp.parent_path())) {
-                std::filesystem::create_directories(fp.parent_path());
-            }
-            if (!std::filesystem::is_directory(fp.parent_path())) {
-                throw std::runtime_error("There is a file named `data`!");
-            }
-        }
-        m_LoggingOut = std::ofstream(m_FilePath, std::ios::app | std::ios::out);
-        if (!m_LoggingOut.is_open())
-            throw std::runtime_error("Could not open file: " + m_FilePath);
-        if (!m_LoggingOut.is_open()) {
-            throw std::runtime_error("Logging output file not opened");
-        }
+void Logger::FlushCounters(std::chrono::time_point<std::chrono::system_clock> t) {
+    if (m_Counters.empty())
+        return;
+    std::string text = "[counters]";
+    for (const auto& [verb, count] : m_Counters) {
+        text += ' ' + verb + '=' + std::to_string(count);
+    }
+    m_Counters.clear();
+    Write(t, text);
+}
+
+void Logger::FlushDueCounters(std::chrono::time_point<std::chrono::system_clock> now) {
+    if (m_Policy.level == LogPolicy::Level::Counters && !m_Counters.empty()
+        && now - m_IntervalStart >= m_Policy.interval) {
+        FlushCounters(now);
     }
-    m_LoggingOut << buffer.str();
-    m_LoggingOut.close();
-}
\ No newline at end of file
+}
+
+void Logger::Show() {
+    FlushCounters(std::chrono::system_clock::now());
+    Outputer::Out() << GetBuffer();
+}
+
+void Logger::Save() {
+    FlushCounters(std::chrono::system_clock::now());
+    m_Sink.Flush();
+}
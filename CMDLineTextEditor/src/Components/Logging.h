@@ -1,26 +1,62 @@
 // Logging.h
 
 #pragma once
-#include <fstream>
-#include <sstream>
+#include <chrono>
+#include <map>
+#include <string>
 
 #include "Command.h"
 #include "Core.h"
+#include "LogSink.h"
 
 std::string GetTimestamp(
     std::chrono::time_point<std::chrono::system_clock> t = std::chrono::system_clock::now());
 
+// which of the handled commands end up in the log
+struct LogPolicy {
+    enum class Level {
+        All,
+        Mutating, // only commands that change the contents
+        Sampled,  // everything but `show`, of which one in sampleRate is logged
+        Counters, // one record per interval with the number of commands of each verb
+    };
+    Level level = Level::All;
+    int sampleRate = 1;
+    std::chrono::seconds interval{60};
+
+    // all, mutating, sample:<N> or counters:<seconds>
+    static bool Parse(const std::string& text, LogPolicy& policy);
+    std::string ToString() const;
+};
+
+// a lightweight handle, the records themselves live in the shared LogSink
 class Logger {
 public:
-    explicit Logger(const std::string& logOutPath);
+    explicit Logger(const std::string& logOutPath, LogSink& sink = LogSink::Get());
     ~Logger();
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
     void Log(const Command& command);
-    void Show() const;
-    std::string GetBuffer() const { return buffer.str(); }
+    void SetPolicy(const LogPolicy& policy);
+    const LogPolicy& GetPolicy() const { return m_Policy; }
+    // closes the running counters interval first, so that the shown log is current
+    void Show();
+    // ends the counters interval when it ran out without a command to notice
+    void FlushDueCounters(std::chrono::time_point<std::chrono::system_clock> now);
+    std::string GetBuffer() const { return m_Sink.GetBuffer(m_Id); }
     void Save();
 
+private:
+    void Write(std::chrono::time_point<std::chrono::system_clock> t, const std::string& text);
+    void FlushCounters(std::chrono::time_point<std::chrono::system_clock> t);
+
 private:
     std::string m_FilePath;
-    std::stringstream buffer;
-    std::ofstream m_LoggingOut;
-};
\ No newline at end of file
+    LogSink& m_Sink;
+    int m_Id;
+    LogPolicy m_Policy;
+    int m_ShowsSeen = 0;
+    std::map<std::string, int> m_Counters;
+    std::chrono::time_point<std::chrono::system_clock> m_IntervalStart;
+};
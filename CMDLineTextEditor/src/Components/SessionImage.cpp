@@ -0,0 +1,275 @@
+#include "SessionImage.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+constexpr char SessionMagic[8] = {'E', 'D', 'S', 'E', 'S', 'S', '\x03', '\n'};
+
+template<typename T>
+void Put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void PutText(std::string& out, std::string_view text) {
+    Put<uint32_t>(out, static_cast<uint32_t>(text.size()));
+    out.append(text);
+}
+
+// reads from a byte range, every read fails once the range is exhausted
+class Reader {
+public:
+    explicit Reader(std::string_view bytes) : m_Bytes(bytes) {}
+
+    template<typename T>
+    bool Get(T& value) {
+        if (m_Bytes.size() - m_Offset < sizeof(T))
+            return false;
+        std::memcpy(&value, m_Bytes.data() + m_Offset, sizeof(T));
+        m_Offset += sizeof(T);
+        return true;
+    }
+
+    bool GetBytes(size_t size, std::string_view& bytes) {
+        if (m_Bytes.size() - m_Offset < size)
+            return false;
+        bytes = m_Bytes.substr(m_Offset, size);
+        m_Offset += size;
+        return true;
+    }
+
+    bool GetText(std::string_view& text) {
+        uint32_t size;
+        return Get(size) && GetBytes(size, text);
+    }
+
+private:
+    std::string_view m_Bytes;
+    size_t m_Offset = 0;
+};
+
+class LinePool {
+public:
+    uint32_t Intern(std::string_view line) {
+        const auto [it, inserted] = m_IdOfLine.try_emplace(line, static_cast<uint32_t>(m_Lines.size()));
+        if (inserted) {
+            m_Lines.push_back(line);
+        }
+        return it->second;
+    }
+    const std::vector<std::string_view>& GetLines() const { return m_Lines; }
+
+private:
+    std::unordered_map<std::string_view, uint32_t> m_IdOfLine;
+    std::vector<std::string_view> m_Lines;
+};
+
+void PutSnapshot(std::string& out, LinePool& pool, const EditorData& data) {
+    Put<uint8_t>(out, data.modified ? 1 : 0);
+    Put<uint8_t>(out, static_cast<uint8_t>(data.logMode));
+    Put<uint32_t>(out, static_cast<uint32_t>(data.lines.size()));
+    for (const auto& line : data.lines) {
+        Put<uint32_t>(out, pool.Intern(line));
+    }
+}
+
+bool GetSnapshot(Reader& in, const std::vector<std::string_view>& pool, EditorData& data) {
+    uint8_t modified, logMode;
+    uint32_t lineCount;
+    if (!in.Get(modified) || !in.Get(logMode) || !in.Get(lineCount))
+        return false;
+    data.modified = modified != 0;
+    data.logMode = static_cast<LogMode>(logMode);
+    data.lines.clear();
+    data.lines.reserve(lineCount);
+    for (uint32_t i = 0; i < lineCount; i++) {
+        uint32_t id;
+        if (!in.Get(id) || id >= pool.size())
+            return false;
+        data.lines.emplace_back(pool[id]);
+    }
+    return true;
+}
+
+// a snapshot as the lines it keeps from `base`: a common prefix and suffix, and the lines in between
+void PutDelta(std::string& out, LinePool& pool, const EditorData& base, const EditorData& data) {
+    const auto& from = base.lines;
+    const auto& to = data.lines;
+    size_t prefix = 0;
+    while (prefix < from.size() && prefix < to.size() && from[prefix] == to[prefix]) {
+        prefix++;
+    }
+    size_t suffix = 0;
+    while (suffix < from.size() - prefix && suffix < to.size() - prefix
+        && from[from.size() - 1 - suffix] == to[to.size() - 1 - suffix]) {
+        suffix++;
+    }
+    Put<uint8_t>(out, data.modified ? 1 : 0);
+    Put<uint8_t>(out, static_cast<uint8_t>(data.logMode));
+    Put<uint32_t>(out, static_cast<uint32_t>(prefix));
+    Put<uint32_t>(out, static_cast<uint32_t>(suffix));
+    Put<uint32_t>(out, static_cast<uint32_t>(to.size() - prefix - suffix));
+    for (size_t i = prefix; i < to.size() - suffix; i++) {
+        Put<uint32_t>(out, pool.Intern(to[i]));
+    }
+}
+
+bool GetDelta(Reader& in, const std::vector<std::string_view>& pool, const EditorData& base, EditorData& data) {
+    uint8_t modified, logMode;
+    uint32_t prefix, suffix, middle;
+    if (!in.Get(modified) || !in.Get(logMode) || !in.Get(prefix) || !in.Get(suffix) || !in.Get(middle))
+        return false;
+    if (static_cast<uint64_t>(prefix) + suffix > base.lines.size())
+        return false;
+    data.modified = modified != 0;
+    data.logMode = static_cast<LogMode>(logMode);
+    data.lines.clear();
+    data.lines.reserve(static_cast<size_t>(prefix) + middle + suffix);
+    data.lines.insert(data.lines.end(), base.lines.begin(), base.lines.begin() + prefix);
+    for (uint32_t i = 0; i < middle; i++) {
+        uint32_t id;
+        if (!in.Get(id) || id >= pool.size())
+            return false;
+        data.lines.emplace_back(pool[id]);
+    }
+    data.lines.insert(data.lines.end(), base.lines.end() - suffix, base.lines.end());
+    return true;
+}
+
+// a stack from the top down, each snapshot against the one above it and the top one against the
+// current content, since neighbours differ by a single edit
+void PutStack(std::string& out, LinePool& pool, const EditorData& current, const std::vector<EditorData>& stack) {
+    Put<uint32_t>(out, static_cast<uint32_t>(stack.size()));
+    const EditorData* base = &current;
+    for (auto it = stack.rbegin(); it != stack.rend(); ++it) {
+        PutDelta(out, pool, *base, *it);
+        base = &*it;
+    }
+}
+
+bool GetStack(Reader& in, const std::vector<std::string_view>& pool, const EditorData& current, std::vector<EditorData>& stack) {
+    uint32_t count;
+    if (!in.Get(count))
+        return false;
+    stack.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        EditorData snapshot;
+        if (!GetDelta(in, pool, stack.empty() ? current : stack.back(), snapshot))
+            return false;
+        stack.push_back(std::move(snapshot));
+    }
+    std::reverse(stack.begin(), stack.end());
+    return true;
+}
+
+} // namespace
+
+std::string SessionImage::SerializeContent(const EditorSession& editor) {
+    // the snapshots are written first, so that the pool is complete when it is placed before them
+    LinePool pool;
+    std::string snapshotBytes;
+    PutSnapshot(snapshotBytes, pool, editor.data);
+    PutStack(snapshotBytes, pool, editor.data, editor.undo);
+    PutStack(snapshotBytes, pool, editor.data, editor.redo);
+
+    std::string out;
+    Put<uint32_t>(out, static_cast<uint32_t>(pool.GetLines().size()));
+    for (const auto line : pool.GetLines()) {
+        PutText(out, line);
+    }
+    out += snapshotBytes;
+    return out;
+}
+
+bool SessionImage::DeserializeContent(std::string_view bytes, EditorSession& editor) {
+    Reader in(bytes);
+    uint32_t poolSize;
+    if (!in.Get(poolSize))
+        return false;
+    std::vector<std::string_view> pool(poolSize);
+    for (auto& line : pool) {
+        if (!in.GetText(line))
+            return false;
+    }
+    return GetSnapshot(in, pool, editor.data) && GetStack(in, pool, editor.data, editor.undo)
+        && GetStack(in, pool, editor.data, editor.redo);
+}
+
+void SessionImage::WriteHeader(std::ostream& out, const nlohmann::json& state, uint32_t editorCount) {
+    std::string header(SessionMagic, sizeof(SessionMagic));
+    const auto stateBytes = nlohmann::json::to_msgpack(state);
+    Put<uint64_t>(header, stateBytes.size());
+    header.append(stateBytes.begin(), stateBytes.end());
+    Put<uint32_t>(header, editorCount);
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+}
+
+void SessionImage::WriteEditor(std::ostream& out, const EditorSession& editor, std::string_view content) {
+    std::string header;
+    PutText(header, editor.path);
+    Put<int64_t>(header, editor.diskTime);
+    Put<int64_t>(header, editor.diskSize);
+    Put<uint64_t>(header, content.size());
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+std::string SessionImage::Serialize() const {
+    std::ostringstream out;
+    WriteHeader(out, state, static_cast<uint32_t>(editors.size()));
+    for (const auto& editor : editors) {
+        WriteEditor(out, editor, SerializeContent(editor));
+    }
+    return out.str();
+}
+
+bool SessionImage::Deserialize(std::string_view bytes, SessionImage& image) {
+    Reader in(bytes);
+    std::string_view magic, stateBytes;
+    uint64_t stateSize;
+    if (!in.GetBytes(sizeof(SessionMagic), magic) || magic != std::string_view(SessionMagic, sizeof(SessionMagic)))
+        return false;
+    if (!in.Get(stateSize) || !in.GetBytes(stateSize, stateBytes))
+        return false;
+    try {
+        image.state = nlohmann::json::from_msgpack(stateBytes.begin(), stateBytes.end());
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    uint32_t editorCount;
+    if (!in.Get(editorCount))
+        return false;
+    image.editors.clear();
+    for (uint32_t i = 0; i < editorCount; i++) {
+        auto& editor = image.editors.emplace_back();
+        std::string_view path, content;
+        uint64_t contentSize;
+        if (!in.GetText(path) || !in.Get(editor.diskTime) || !in.Get(editor.diskSize)
+            || !in.Get(contentSize) || !in.GetBytes(contentSize, content))
+            return false;
+        editor.path = path;
+        if (!DeserializeContent(content, editor))
+            return false;
+    }
+    return true;
+}
+
+void SessionImage::Stamp(EditorSession& editor) {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(editor.path, ec);
+    editor.diskTime = ec ? -1 : static_cast<int64_t>(time.time_since_epoch().count());
+    const auto size = std::filesystem::file_size(editor.path, ec);
+    editor.diskSize = ec ? -1 : static_cast<int64_t>(size);
+}
+
+bool SessionImage::MatchesDisk(const EditorSession& editor) {
+    EditorSession now;
+    now.path = editor.path;
+    Stamp(now);
+    return now.diskTime == editor.diskTime && now.diskSize == editor.diskSize;
+}
@@ -0,0 +1,39 @@
+// SessionImage.h
+
+#pragma once
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+#include "Editor.h"
+
+// binary image of a whole session: the workspace state plus the content and undo/redo
+// history of every loaded editor. the content of an editor is kept on its own: its lines once
+// in a string pool, referenced by index, and each undo/redo step only as the lines it changed
+// against its neighbour, so a long history costs little more than one copy of the file and its
+// edits. the swap file of an evicted editor holds the same content, and goes into an image as is.
+// integers are in native byte order, an image is not meant to move between machines
+struct SessionImage {
+    nlohmann::json state;
+    std::vector<EditorSession> editors;
+
+    std::string Serialize() const;
+    // false when `bytes` is not a complete session image
+    static bool Deserialize(std::string_view bytes, SessionImage& image);
+
+    // the content and history of one editor, without its path and stamp
+    static std::string SerializeContent(const EditorSession& editor);
+    static bool DeserializeContent(std::string_view bytes, EditorSession& editor);
+    // an image written editor by editor, so that they need not all be in memory at once:
+    // the header, then exactly `editorCount` editors with the path and stamp of `editor`
+    static void WriteHeader(std::ostream& out, const nlohmann::json& state, uint32_t editorCount);
+    static void WriteEditor(std::ostream& out, const EditorSession& editor, std::string_view content);
+
+    // records the last write time and size of the editor's file
+    static void Stamp(EditorSession& editor);
+    // whether the file is unchanged since it was stamped
+    static bool MatchesDisk(const EditorSession& editor);
+};
@@ -0,0 +1,58 @@
+#include "Timestamp.h"
+
+#include <cstring>
+#include <ctime>
+
+namespace {
+    struct TimestampCache {
+        std::time_t minute = -1; // seconds since epoch of the cached minute
+        char text[TimestampLength];
+    };
+
+    void WriteDigits(char* out, int value, int width) {
+        for (int i = width - 1; i >= 0; i--) {
+            out[i] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    bool ToLocalTime(std::time_t timeTick, std::tm& tm) {
+#ifdef _WIN32
+        return localtime_s(&tm, &timeTick) == 0;
+#else
+        return localtime_r(&timeTick, &tm) != nullptr;
+#endif
+    }
+}
+
+void FormatTimestamp(std::chrono::time_point<std::chrono::system_clock> t, char* out) {
+    thread_local TimestampCache cache;
+    const auto timeTick = std::chrono::system_clock::to_time_t(t);
+    // time zone offsets are whole minutes, so the local minute only changes with the UTC minute
+    std::time_t minute = timeTick - timeTick % 60;
+    int second = static_cast<int>(timeTick % 60);
+    if (second < 0) {
+        minute -= 60;
+        second += 60;
+    }
+
+    if (minute != cache.minute) {
+        std::tm tm{};
+        if (!ToLocalTime(timeTick, tm)) {
+            std::memset(out, '0', TimestampLength);
+            return;
+        }
+        char* text = cache.text;
+        WriteDigits(text, tm.tm_year + 1900, 4);
+        WriteDigits(text + 4, tm.tm_mon + 1, 2);
+        WriteDigits(text + 6, tm.tm_mday, 2);
+        text[8] = ' ';
+        WriteDigits(text + 9, tm.tm_hour, 2);
+        text[11] = ':';
+        WriteDigits(text + 12, tm.tm_min, 2);
+        text[14] = ':';
+        cache.minute = minute;
+    }
+    WriteDigits(cache.text + 15, second, 2);
+    std::memcpy(out, cache.text, TimestampLength);
+}
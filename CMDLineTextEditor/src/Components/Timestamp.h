@@ -0,0 +1,13 @@
+// Timestamp.h
+
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+// length of "YYYYMMDD HH:MM:SS"
+constexpr size_t TimestampLength = 17;
+
+// writes exactly TimestampLength characters (no terminator) into `out`.
+// the local date and time of the last formatted minute is cached per thread,
+// so consecutive calls only patch the seconds.
+void FormatTimestamp(std::chrono::time_point<std::chrono::system_clock> t, char* out);
@@ -1,27 +1,46 @@
 #include "Workspace.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
+#include <tuple>
 
+#include "MappedFile.h"
 #include "Outputer.h"
 #include "TreeDrawer.h"
 
 #include "nlohmann/json.hpp"
 
-Workspace::Workspace(const std::string& workspaceData)
+Workspace::Workspace(std::string_view workspaceData, const std::string& journalPath)
     : CommandExecutor()
 {
-    m_CurrentEditor = -1;
+    m_CurrentEditor = InvalidEditor;
     m_LogMode = LogMode::NoLog;
     m_Running = true;
-    if (workspaceData.find_first_not_of("\n\t ") != std::string::npos) {
+    m_Journal = CreateRef<EditJournal>(journalPath);
+    m_Autosave = CreateScope<AutosaveService>([this]() { Autosave(); });
+    // a session image left by `session-save` has everything the state has and more
+    const MappedFile sessionFile(SessionImagePath);
+    if (SessionImage image; !sessionFile.GetView().empty() && SessionImage::Deserialize(sessionFile.GetView(), image)) {
+        RestoreSession(image);
+    } else if (const auto first = workspaceData.find_first_not_of("\n\t\r "); first != std::string_view::npos) {
         try {
-            nlohmann::json inData = nlohmann::json::parse(workspaceData);
+            // JSON states start with an object, binary ones with a MessagePack map
+            nlohmann::json inData = workspaceData[first] == '{'
+                ? nlohmann::json::parse(workspaceData)
+                : nlohmann::json::from_msgpack(workspaceData.begin(), workspaceData.end());
             DeserializeJson(inData);
         } catch (const std::exception&) {}
     }
+    RecoverFromJournal();
     m_Logger = CreateScope<Logger>("data/.workspace.log");
     RegisterCommandHandlingStrategies();
+    // last, the autosave thread must not run while the workspace is still being built
+    m_Autosave->SetInterval(m_RestoredAutosaveInterval);
+}
+
+Workspace::~Workspace() {
+    m_Autosave.reset();
 }
 
 void Workspace::Handle(const Command& command)
@@ -37,9 +56,182 @@ void Workspace::Handle(const Command& command)
     }
 }
 
-void Workspace::CreateEditorByFilePath(const std::string& fp) {
+void Workspace::EnforceMemoryBudget() {
+    if (m_MemoryBudget == 0)
+        return;
+    size_t resident = 0;
+    for (const auto& editor : m_Editors) {
+        resident += editor->GetResidentBytes();
+    }
+    const auto current = GetCurrentEditor();
+    for (auto editor = m_RecentEditors.Back(); editor && resident > m_MemoryBudget; editor = m_RecentEditors.Prev(editor)) {
+        if (editor == current.get() || !editor->IsLoaded())
+            continue;
+        const auto bytes = editor->GetResidentBytes();
+        if (editor->Evict()) {
+            resident -= bytes - editor->GetResidentBytes();
+        } else {
+            Outputer::InfoLn() << "Failed to evict `" << editor->GetFilePath() << "`";
+        }
+    }
+    // the trigram indexes of evicted editors go last, without them a search loads the editor
+    for (auto editor = m_RecentEditors.Back(); editor && resident > m_MemoryBudget; editor = m_RecentEditors.Prev(editor)) {
+        if (editor->IsLoaded())
+            continue;
+        const auto bytes = editor->GetResidentBytes();
+        editor->DropIndex();
+        resident -= bytes - editor->GetResidentBytes();
+    }
+}
+
+Workspace::EditorHandle Workspace::CreateEditorByFilePath(const std::string& fp) {
     const Ref<Editor> editor = CreateRef<Editor>(fp);
-    m_Editors.push_back(editor);
+    editor->SetJournal(m_Journal);
+    return AddEditor(editor);
+}
+
+std::vector<Workspace::EditorHandle> Workspace::OpenEditors(const std::vector<std::string>& paths) {
+    std::vector<EditorHandle> handles(paths.size(), InvalidEditor);
+    std::vector<std::pair<size_t, std::future<EditorFileData>>> reads;
+    std::unordered_map<std::string, size_t> firstOfPath;
+    for (size_t i = 0; i < paths.size(); i++) {
+        handles[i] = GetEditorHandleByPath(paths[i]);
+        if (handles[i] != InvalidEditor)
+            continue;
+        // the same file named twice is read once
+        if (!firstOfPath.try_emplace(CanonicalizePath(paths[i]), i).second)
+            continue;
+        reads.emplace_back(i, GetThreadPool().Submit([path = paths[i]]() { return ReadEditorFile(path); }));
+    }
+    // editors are registered in argument order, whichever read finished first
+    for (auto& [i, read] : reads) {
+        try {
+            const Ref<Editor> editor = CreateRef<Editor>(paths[i], read.get());
+            editor->SetJournal(m_Journal);
+            handles[i] = AddEditor(editor);
+        } catch (const std::exception& e) {
+            Outputer::InfoLn() << "Failed to open `" << paths[i] << "`: " << e.what();
+        }
+    }
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (handles[i] == InvalidEditor) {
+            handles[i] = GetEditorHandleByPath(paths[i]);
+        }
+    }
+    return handles;
+}
+
+void Workspace::LoadEditors(const std::vector<EditorHandle>& handles) {
+    std::vector<std::pair<Ref<Editor>, std::future<EditorFileData>>> reads;
+    for (const auto handle : handles) {
+        const auto editor = m_Editors.Get(handle);
+        if (!editor || (*editor)->IsLoaded() || (*editor)->IsEvicted())
+            continue;
+        reads.emplace_back(*editor, GetThreadPool().Submit([path = (*editor)->GetFilePath()]() {
+            return ReadEditorFile(path);
+        }));
+    }
+    for (auto& [editor, read] : reads) {
+        try {
+            editor->LoadFrom(read.get());
+        } catch (const std::exception& e) {
+            // stays unloaded, using it reports the error again
+            Outputer::InfoLn() << "Failed to load `" << editor->GetFilePath() << "`: " << e.what();
+        }
+    }
+}
+
+void Workspace::SetThreadCount(size_t threadCount) {
+    m_ThreadCount = std::max<size_t>(threadCount, 1);
+    m_ThreadPool.reset();
+}
+
+ThreadPool& Workspace::GetThreadPool() {
+    if (!m_ThreadPool) {
+        m_ThreadPool = CreateScope<ThreadPool>(m_ThreadCount);
+    }
+    return *m_ThreadPool;
+}
+
+Workspace::EditorHandle Workspace::AddEditor(const Ref<Editor>& editor) {
+    const auto handle = m_Editors.Insert(editor);
+    m_EditorByPath[editor->GetCanonicalPath()] = handle;
+    m_RecentEditors.PushFront(editor.get());
+    return handle;
+}
+
+void Workspace::RemoveEditor(EditorHandle handle) {
+    const auto editor = m_Editors.Get(handle);
+    if (!editor)
+        return;
+    m_EditorByPath.erase((*editor)->GetCanonicalPath());
+    m_RecentEditors.Remove(editor->get());
+    m_Editors.Erase(handle);
+}
+
+/**
+ * replays the edits that were journaled but never saved, e.g. after a crash
+ */
+void Workspace::RecoverFromJournal() {
+    const auto pending = EditJournal::ReadPending(m_Journal->GetPath());
+    // every file with pending edits is needed right away, so read them all at once
+    std::vector<std::string> paths;
+    for (const auto& [path, commandLines] : pending) {
+        paths.push_back(path);
+    }
+    const auto handles = OpenEditors(paths);
+    LoadEditors(handles);
+    for (size_t i = 0; i < pending.size(); i++) {
+        const auto& [path, commandLines] = pending[i];
+        const auto editor = m_Editors.Get(handles[i]);
+        if (!editor || !(*editor)->IsLoaded()) {
+            Outputer::InfoLn() << "Failed to recover `" << path << "`";
+            continue;
+        }
+        int replayed = 0;
+        for (const auto& commandLine : commandLines) {
+            if (JournalChange change; EditJournal::ParseChange(commandLine, change)) {
+                replayed += (*editor)->Replay(change) ? 1 : 0;
+                continue;
+            }
+            Command command(commandLine);
+            if (command.GetType() != Command::Type::None && (*editor)->Replay(command)) {
+                replayed++;
+            }
+        }
+        Outputer::InfoLn() << "Recovered " << replayed << " unsaved edit(s): " << path;
+    }
+    if (!m_Editors.Contains(m_CurrentEditor)) {
+        m_CurrentEditor = GetLastEditorHandle();
+    }
+}
+
+void Workspace::RestoreSession(SessionImage& image) {
+    DeserializeJson(image.state);
+    // the journal was cleared when the image was written. a file saved or closed after that, e.g. by the
+    // session that restored this image before, has its current content on disk, the image is stale for it
+    const auto settled = EditJournal::ReadSettled(m_Journal->GetPath());
+    size_t restored = 0;
+    for (auto& session : image.editors) {
+        const auto editor = GetEditorByPath(session.path);
+        if (!editor)
+            continue;
+        if (std::find(settled.begin(), settled.end(), session.path) != settled.end()) {
+            // the state of the image still has it modified
+            editor->SetModified(false);
+            continue;
+        }
+        // the journal was cleared when the image was written, so its content exists nowhere else and
+        // later journal records were made against it. it is kept over the file, to be saved or not
+        if (!SessionImage::MatchesDisk(session)) {
+            Outputer::InfoLn() << "Warning: `" << session.path
+                << "` changed on disk since the session was saved, keeping the session content unsaved";
+            session.data.modified = true;
+        }
+        editor->RestoreSession(std::move(session));
+        restored++;
+    }
+    Outputer::InfoLn() << "Session restored: " << restored << " editor(s)";
 }
 
 void Workspace::RegisterCommandHandlingStrategies() {
@@ -53,27 +245,52 @@ void Workspace::RegisterCommandHandlingStrategies() {
     m_Dispatcher.Register(Command::Type::LogOn, &Workspace::HandleLogOn);
     m_Dispatcher.Register(Command::Type::LogOff, &Workspace::HandleLogOff);
     m_Dispatcher.Register(Command::Type::LogShow, &Workspace::HandleLogShow);
+    m_Dispatcher.Register(Command::Type::LogLevel, &Workspace::HandleLogLevel);
+    m_Dispatcher.Register(Command::Type::ExportJson, &Workspace::HandleExportJson);
+    m_Dispatcher.Register(Command::Type::SessionSave, &Workspace::HandleSessionSave);
+    m_Dispatcher.Register(Command::Type::Autosave, &Workspace::HandleAutosave);
+    m_Dispatcher.Register(Command::Type::Recover, &Workspace::HandleRecover);
+    m_Dispatcher.Register(Command::Type::MemBudget, &Workspace::HandleMemBudget);
+    m_Dispatcher.Register(Command::Type::ReplaceAll, &Workspace::HandleReplaceAll);
+    m_Dispatcher.Register(Command::Type::Search, &Workspace::HandleSearch);
+    m_Dispatcher.Register(Command::Type::Grep, &Workspace::HandleGrep);
     m_Dispatcher.Register(Command::Type::Exit, &Workspace::HandleExit);
 }
 
 bool Workspace::HandleLoad(const Command& command)
 {
-    auto fp = command.GetArgs()[0];
-    if (auto existing = GetEditorIndexByPath(fp); existing >= 0){
-        m_CurrentEditor = existing;
-        return false;
-    }
-    try {
-        CreateEditorByFilePath(fp);
-    } catch (const std::exception& e) {
-        Outputer::ErrorLn(command) << "Failed to create editor: " << e.what();
-        return false;
-    }
+    const auto& paths = command.GetArgs();
+    if (paths.size() == 1 && !paths[0].empty() && paths[0][0] == '@')
+        return LoadHit(command, paths[0].substr(1));
+    if (paths.size() == 1) {
+        auto fp = paths[0];
+        if (auto existing = GetEditorHandleByPath(fp); existing != InvalidEditor){
+            m_CurrentEditor = existing;
+            return false;
+        }
+        try {
+            m_CurrentEditor = CreateEditorByFilePath(fp);
+        } catch (const std::exception& e) {
+            Outputer::ErrorLn(command) << "Failed to create editor: " << e.what();
+            return false;
+        }
 
-    m_CurrentEditor = static_cast<int>(m_Editors.size()) - 1;
-    UpdateLogMode(GetCurrentEditor()->GetLogMode());
+        UpdateLogMode(GetCurrentEditor()->GetLogMode());
 
-    return true;
+        return true;
+    }
+    // several files are read in parallel, the last one named becomes current. editors restored from
+    // the state are only registered, they are read in parallel here as well instead of one by one on use
+    const auto editorCountBefore = m_Editors.Size();
+    const auto handles = OpenEditors(paths);
+    LoadEditors(handles);
+    for (const auto handle : handles) {
+        if (handle == InvalidEditor)
+            continue;
+        m_CurrentEditor = handle;
+        UpdateLogMode((*m_Editors.Get(handle))->GetLogMode());
+    }
+    return m_Editors.Size() != editorCountBefore;
 }
 
 bool Workspace::HandleSave(const Command& command){
@@ -90,9 +307,20 @@ bool Workspace::HandleSave(const Command& command){
     }
     const auto fp = command.GetArgs()[0];
     if (fp == "all"){
-        for (const auto& editor : m_Editors){
-            editor->Save();
+        size_t concurrency = 4;
+        if (args.size() == 2) {
+            if (args[1].empty() || args[1].size() > 4 || args[1].find_first_not_of("0123456789") != std::string::npos
+                || std::stoul(args[1]) == 0) {
+                Outputer::ErrorLn(command) << "Invalid concurrency: " << args[1];
+                return false;
+            }
+            concurrency = std::stoul(args[1]);
         }
+        return SaveAll(command, concurrency);
+    }
+    if (args.size() == 2) {
+        Outputer::ErrorLn(command) << "Only `save all` takes a concurrency";
+        return false;
     }
     target = GetEditorByPath(fp);
     if (target == nullptr){
@@ -100,15 +328,287 @@ bool Workspace::HandleSave(const Command& command){
         return false;
     }
     target->Save();
-    GetCurrentEditor()->UpdateTime();
+    if (const auto current = GetCurrentEditor()) {
+        current->UpdateTime();
+    }
 
     return true;
 }
 
+bool Workspace::SaveAll(const Command& command, size_t concurrency) {
+    struct SaveResult {
+        uintmax_t bytes = 0;
+        std::chrono::microseconds time{0};
+        std::string error;
+    };
+    std::vector<Ref<Editor>> targets;
+    for (const auto& editor : m_Editors) {
+        if (!editor->IsModified())
+            continue;
+        try {
+            editor->EnsureLoaded();
+            targets.push_back(editor);
+        } catch (const std::exception& e) {
+            Outputer::ErrorLn(command) << editor->GetFilePath() << ": " << e.what();
+        }
+    }
+    if (!m_IoPool || m_IoPool->GetThreadCount() != concurrency) {
+        m_IoPool = CreateScope<ThreadPool>(concurrency);
+    }
+    // the workers only read the lines, nothing changes them until every write is done
+    const auto begin = std::chrono::steady_clock::now();
+    std::vector<std::future<SaveResult>> writes;
+    writes.reserve(targets.size());
+    for (const auto& editor : targets) {
+        writes.push_back(m_IoPool->Submit([&path = editor->GetFilePath(), &lines = editor->GetLines()]() {
+            SaveResult result;
+            const auto start = std::chrono::steady_clock::now();
+            try {
+                result.bytes = WriteEditorFile(path, lines);
+            } catch (const std::exception& e) {
+                result.error = e.what();
+            }
+            result.time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            return result;
+        }));
+    }
+
+    uintmax_t totalBytes = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < targets.size(); i++) {
+        const auto result = writes[i].get();
+        if (!result.error.empty()) {
+            failed++;
+            Outputer::InfoLn() << "Failed: " << targets[i]->GetFilePath() << " (" << result.error << ")";
+            continue;
+        }
+        targets[i]->MarkSaved();
+        totalBytes += result.bytes;
+        Outputer::InfoLn() << "Saved: " << targets[i]->GetFilePath() << " (" << result.bytes << " B, "
+            << result.time.count() / 1000.0 << " ms)";
+    }
+    // a session image written before must not win over the files after a crash
+    if (!m_Journal->Commit()) {
+        Outputer::InfoLn() << "Warning: the journal could not record the saves";
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    Outputer::InfoLn() << "Saved " << targets.size() - failed << " file(s), " << totalBytes << " B in "
+        << elapsed.count() / 1000.0 << " ms on " << concurrency << " thread(s)"
+        << (failed > 0 ? ", " + std::to_string(failed) + " failed" : std::string());
+    return failed == 0;
+}
+
+// an argument as Command parses it back: quoted when it has spaces or is empty. a parsed argument
+// holding a quote had no spaces, so it never needs both
+static std::string QuoteArgument(const std::string& arg) {
+    return arg.empty() || arg.find(' ') != std::string::npos ? '"' + arg + '"' : arg;
+}
+
+/**
+ * `replace-all <pattern> <replacement>` is `replace-re` on every editor. the replacements are computed
+ * concurrently, each editor then gets them as one modification, journaled as the `replace-re` it equals
+ */
+bool Workspace::HandleReplaceAll(const Command& command) {
+    const auto& args = command.GetArgs();
+    Ref<Regex> regex;
+    try {
+        regex = RegexCache::Shared().Get(args[0]);
+    } catch (const std::invalid_argument& e) {
+        Outputer::ErrorLn(command) << "Invalid pattern: " << e.what();
+        return false;
+    }
+    std::vector<Ref<Editor>> editors(m_Editors.begin(), m_Editors.end());
+    const Command replayed("replace-re " + QuoteArgument(args[0]) + ' ' + QuoteArgument(args[1]));
+    // under a memory budget, editors are loaded a few at a time and evicted again after their batch,
+    // so that the whole workspace is never resident at once
+    const size_t batchSize = m_MemoryBudget == 0 ? editors.size() : GetThreadPool().GetThreadCount();
+    const auto begin = std::chrono::steady_clock::now();
+    size_t total = 0, files = 0, searched = 0, taskCount = 0;
+    for (size_t batchBegin = 0; batchBegin < editors.size(); batchBegin += batchSize) {
+        std::vector<Ref<Editor>> targets;
+        std::vector<const std::vector<std::string>*> contents;
+        for (size_t i = batchBegin; i < std::min(batchBegin + batchSize, editors.size()); i++) {
+            try {
+                contents.push_back(&editors[i]->GetLines());
+                targets.push_back(editors[i]);
+            } catch (const std::exception& e) {
+                Outputer::ErrorLn(command) << editors[i]->GetFilePath() << ": " << e.what();
+            }
+        }
+
+        // a Regex builds its DFA while matching, so every task matches with its own copy and
+        // takes the next editor until none is left. the lines are only read until all tasks are done
+        std::vector<RegexReplacement> replacements(targets.size());
+        std::atomic<size_t> next{0};
+        const size_t batchTasks = std::min(GetThreadPool().GetThreadCount(), targets.size());
+        taskCount = std::max(taskCount, batchTasks);
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(batchTasks);
+        for (size_t t = 0; t < batchTasks; t++) {
+            tasks.push_back(GetThreadPool().Submit([&]() {
+                Regex copy = *regex;
+                for (size_t i = next++; i < targets.size(); i = next++) {
+                    replacements[i] = ReplaceRegexMatches(*contents[i], 0, SIZE_MAX, copy, args[1]);
+                }
+            }));
+        }
+        for (auto& task : tasks) {
+            task.get();
+        }
+
+        for (size_t i = 0; i < targets.size(); i++) {
+            if (replacements[i].lines.empty())
+                continue;
+            total += replacements[i].count;
+            files++;
+            Outputer::InfoLn() << "Replaced: " << targets[i]->GetFilePath() << " (" << replacements[i].count
+                << " in " << replacements[i].lines.size() << " line(s))";
+            targets[i]->ApplyReplacement(replayed, std::move(replacements[i]));
+        }
+        searched += targets.size();
+        EnforceMemoryBudget();
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin);
+    Outputer::InfoLn(command) << total << " replacement(s) in " << files << " of " << searched << " file(s), "
+        << elapsed.count() / 1000.0 << " ms on " << taskCount << " thread(s)";
+    return true;
+}
+
+/**
+ * `search <text>` finds text in every editor, printed as `path:line:col: <line>`. each editor keeps a
+ * trigram index of its lines, so editors and lines that cannot hold the text are not searched at all
+ */
+bool Workspace::HandleSearch(const Command& command) {
+    const auto& needle = command.GetArgs()[0];
+    if (needle.empty()) {
+        Outputer::ErrorLn(command) << "Nothing to search";
+        return false;
+    }
+    const TrigramQuery query(needle);
+    constexpr size_t flushSize = 64 * 1024;
+    std::string out;
+    size_t hitCount = 0, files = 0, checkedLines = 0;
+    for (const auto& editor : m_Editors) {
+        std::vector<TextHit> hits;
+        try {
+            hits = editor->SearchIndexed(query, checkedLines);
+        } catch (const std::exception& e) {
+            Outputer::ErrorLn(command) << editor->GetFilePath() << ": " << e.what();
+            continue;
+        }
+        if (hits.empty())
+            continue;
+        files++;
+        hitCount += hits.size();
+        const auto& lines = editor->GetLines();
+        for (const auto& hit : hits) {
+            out += editor->GetFilePath() + ':' + std::to_string(hit.line + 1) + ':' + std::to_string(hit.column + 1) + ": ";
+            out += lines[hit.line];
+            out += '\n';
+            if (out.size() >= flushSize) {
+                Outputer::Out() << out;
+                out.clear();
+            }
+        }
+    }
+    Outputer::Out() << out;
+    Outputer::InfoLn(command) << hitCount << " hit(s) in " << files << " file(s), " << checkedLines << " line(s) searched";
+    return true;
+}
+
+/**
+ * `grep <text> [dir]` finds text in every file below a directory, the current one by default, printed as
+ * `@N path:line:col: <line>`. files are mapped and searched on the thread pool, the tree comes from the
+ * `dir-tree` cache. `load @N` opens the file of a hit
+ */
+bool Workspace::HandleGrep(const Command& command) {
+    const auto& args = command.GetArgs();
+    if (args[0].empty()) {
+        Outputer::ErrorLn(command) << "Nothing to find";
+        return false;
+    }
+    const std::string root = args.size() == 2 ? args[1] : ".";
+    std::vector<std::string> files;
+    try {
+        if (!m_DirTreeCache) {
+            m_DirTreeCache = CreateScope<DirTreeCache>(m_ThreadCount);
+        }
+        files = ListFiles(root, m_DirTreeCache->Get(root));
+    } catch (const std::exception& e) {
+        Outputer::ErrorLn(command) << e.what();
+        return false;
+    }
+    m_LastGrep = SearchFiles(std::move(files), SubstringSearcher(args[0]), GetThreadPool());
+
+    constexpr size_t flushSize = 64 * 1024;
+    std::string out;
+    size_t filesWithHits = 0;
+    // hits keep only offsets, so each file with hits is mapped once more to print its lines
+    Scope<MappedFile> mapped;
+    for (size_t i = 0; i < m_LastGrep.hits.size(); i++) {
+        const auto& hit = m_LastGrep.hits[i];
+        if (i == 0 || m_LastGrep.hits[i - 1].file != hit.file) {
+            filesWithHits++;
+            mapped = CreateScope<MappedFile>(m_LastGrep.files[hit.file], true);
+        }
+        out += '@' + std::to_string(i + 1) + ' ' + m_LastGrep.files[hit.file] + ':' + std::to_string(hit.line + 1) + ':'
+            + std::to_string(hit.column + 1) + ": ";
+        out += GetHitLine(mapped->GetView(), hit);
+        out += '\n';
+        if (out.size() >= flushSize) {
+            Outputer::Out() << out;
+            out.clear();
+        }
+    }
+    Outputer::Out() << out;
+    Outputer::InfoLn(command) << m_LastGrep.hits.size() << " hit(s) in " << filesWithHits << " of "
+        << m_LastGrep.files.size() << " file(s)"
+        << (m_LastGrep.binaryFiles > 0 ? ", " + std::to_string(m_LastGrep.binaryFiles) + " binary file(s) skipped" : std::string())
+        << (m_LastGrep.specialFiles > 0 ? ", " + std::to_string(m_LastGrep.specialFiles) + " special file(s) skipped" : std::string());
+    return true;
+}
+
+bool Workspace::LoadHit(const Command& command, const std::string& hitText) {
+    if (hitText.empty() || hitText.size() > 9 || hitText.find_first_not_of("0123456789") != std::string::npos
+        || std::stoul(hitText) == 0) {
+        Outputer::ErrorLn(command) << "Invalid hit number: " << hitText;
+        return false;
+    }
+    const size_t wanted = std::stoul(hitText);
+    if (wanted > m_LastGrep.hits.size()) {
+        Outputer::ErrorLn(command) << "No hit @" << wanted << ", the last `grep` had " << m_LastGrep.hits.size();
+        return false;
+    }
+    const auto& hit = m_LastGrep.hits[wanted - 1];
+    const auto& fp = m_LastGrep.files[hit.file];
+    Ref<Editor> editor;
+    try {
+        if (const auto existing = GetEditorHandleByPath(fp); existing != InvalidEditor) {
+            m_CurrentEditor = existing;
+        } else {
+            m_CurrentEditor = CreateEditorByFilePath(fp);
+        }
+        editor = GetCurrentEditor();
+        editor->EnsureLoaded();
+    } catch (const std::exception& e) {
+        Outputer::ErrorLn(command) << "Failed to open `" << fp << "`: " << e.what();
+        return false;
+    }
+    editor->UpdateTime();
+    UpdateLogMode(editor->GetLogMode());
+    // the buffer may have been edited since, the hit is shown where it was
+    const auto& lines = editor->GetLines();
+    Outputer::Out() << hit.line + 1 << ':' << hit.column + 1 << '\n';
+    if (hit.line < lines.size()) {
+        Outputer::Out() << lines[hit.line] << '\n' << std::string(hit.column, ' ') << "^\n";
+    }
+    return true;
+}
+
 bool Workspace::HandleInit(const Command& command){
     auto& args = command.GetArgs();
     const auto& fp = args[0];
-    if (GetEditorIndexByPath(fp) >= 0){
+    if (GetEditorHandleByPath(fp) != InvalidEditor){
         Outputer::ErrorLn(command) << "File `" << args[0] << "` found in workspace";
         return false;
     }
@@ -119,41 +619,39 @@ bool Workspace::HandleInit(const Command& command){
     Ref<Editor> editor;
     try {
         editor = CreateRef<Editor>(fp, logMode);
+        editor->SetJournal(m_Journal);
     } catch (const std::exception& e) {
         Outputer::ErrorLn(command) << "Failed to create editor: " << e.what();
         return false;
     }
-    m_CurrentEditor = static_cast<int>(m_Editors.size());
-    m_Editors.push_back(editor);
+    m_CurrentEditor = AddEditor(editor);
     GetCurrentEditor()->UpdateTime();
     UpdateLogMode(GetCurrentEditor()->GetLogMode());
 
     return true;
 }
 bool Workspace::HandleClose(const Command& command){
+    auto target = m_CurrentEditor;
     if (!command.GetArgs().empty()){
         // user specified file
-        auto fp = command.GetArgs()[0];
-        int editorIndex = GetEditorIndexByPath(fp);
-        if (editorIndex >= 0){
-            m_Editors[editorIndex]->AskSaving();
-            m_Editors.erase(m_Editors.begin() + editorIndex);
-            m_CurrentEditor = GetLastEditorIndex();
-        } else{
-            Outputer::ErrorLn(command) << "File `" << fp << "` not found in workspace";
+        target = GetEditorHandleByPath(command.GetArgs()[0]);
+        if (target == InvalidEditor){
+            Outputer::ErrorLn(command) << "File `" << command.GetArgs()[0] << "` not found in workspace";
             return false;
         }
     }
 
-    if (m_CurrentEditor < 0 || m_CurrentEditor >= m_Editors.size()){
+    const auto editor = m_Editors.Get(target);
+    if (!editor){
         Outputer::ErrorLn(command) << "No current editor";
         return false;
     }
 
-    m_Editors[m_CurrentEditor]->AskSaving();
-    Outputer::InfoLn() << "File closed: " << m_Editors[m_CurrentEditor]->GetFilePath();
-    m_Editors.erase(m_Editors.begin() + m_CurrentEditor);
-    m_CurrentEditor = GetLastEditorIndex();
+    (*editor)->AskSaving();
+    m_Journal->MarkClosed((*editor)->GetFilePath());
+    Outputer::InfoLn() << "File closed: " << (*editor)->GetFilePath();
+    RemoveEditor(target);
+    m_CurrentEditor = GetLastEditorHandle();
     if (GetCurrentEditor()) {
         UpdateLogMode(GetCurrentEditor()->GetLogMode());
     }
@@ -163,8 +661,8 @@ bool Workspace::HandleClose(const Command& command){
 }
 
 bool Workspace::HandleEdit(const Command& command){
-    auto to = GetEditorIndexByPath(command.GetArgs()[0]);
-    if (to < 0){
+    auto to = GetEditorHandleByPath(command.GetArgs()[0]);
+    if (to == InvalidEditor){
         Outputer::ErrorLn(command) << "No such editor for file - " << command.GetArgs()[0];
         return false;
     }
@@ -175,30 +673,116 @@ bool Workspace::HandleEdit(const Command& command){
     return true;
 }
 bool Workspace::HandleEditorList(const Command& command) {
-    for (int i = 0; i < m_Editors.size(); i++){
-        if (i == m_CurrentEditor){
+    const auto printEditor = [this](EditorHandle handle, const Ref<Editor>& editor) {
+        if (handle == m_CurrentEditor){
             Outputer::Out() << ">";
         } else {
             Outputer::Out() << " ";
         }
-        Outputer::Out() << ' ' << m_Editors[i]->GetFilePath();
-        if (m_Editors[i]->IsModified()){
+        Outputer::Out() << " #" << handle << ' ' << editor->GetFilePath();
+        if (editor->IsModified()){
             Outputer::Out() << '*';
         }
+        if (editor->IsLoaded()) {
+            Outputer::Out() << "  [resident " << editor->GetResidentBytes() << " B]";
+        } else if (editor->IsEvicted()) {
+            Outputer::Out() << "  [evicted " << editor->GetSwapBytes() << " B]";
+        } else {
+            Outputer::Out() << "  [not loaded]";
+        }
         Outputer::Out() << '\n';
+    };
+    if (command.GetArgs().empty()) {
+        // in open order, the dense order changes when an editor is closed
+        for (const auto handle : m_Editors.GetHandlesInInsertionOrder()) {
+            printEditor(handle, *m_Editors.Get(handle));
+        }
+        return true;
+    }
+    if (command.GetArgs()[0] != "--recent") {
+        Outputer::ErrorLn(command) << "Unknown option `" << command.GetArgs()[0] << "`, expected --recent";
+        return false;
+    }
+    for (auto editor = m_RecentEditors.Front(); editor; editor = m_RecentEditors.Next(editor)) {
+        const auto handle = m_EditorByPath.at(editor->GetCanonicalPath());
+        printEditor(handle, *m_Editors.Get(handle));
     }
 
     return true;
 }
+/**
+ * `dir-tree [dir] [--depth N] [--max-entries M] [--include <glob>]... [--exclude <glob>]... [--summary]`
+ * globs match entry names. a tree pruned by --depth or --exclude is walked on its own,
+ * everything else is drawn from the cached tree. --summary adds the size and file count of every
+ * directory, which always covers the whole depth, and lists the largest files
+ */
 bool Workspace::HandleDirTree(const Command& command) {
+    const auto& args = command.GetArgs();
     std::string fp;
-    if (!command.GetArgs().empty()) {
-        fp = command.GetArgs()[0];
-    } else {
+    DirTreeOptions options;
+    for (size_t i = 0; i < args.size(); i++) {
+        const auto& arg = args[i];
+        if (arg.rfind("--", 0) != 0) {
+            if (!fp.empty()) {
+                Outputer::ErrorLn(command) << "More than one directory given";
+                return false;
+            }
+            fp = arg;
+            continue;
+        }
+        if (arg == "--summary") {
+            options.summary = true;
+            continue;
+        }
+        if (arg != "--depth" && arg != "--max-entries" && arg != "--include" && arg != "--exclude") {
+            Outputer::ErrorLn(command) << "Unknown option `" << arg << "`";
+            return false;
+        }
+        if (i + 1 == args.size()) {
+            Outputer::ErrorLn(command) << "Missing value of " << arg;
+            return false;
+        }
+        const auto& value = args[++i];
+        if (arg == "--include") {
+            options.include.push_back(value);
+        } else if (arg == "--exclude") {
+            options.walk.exclude.push_back(value);
+        } else {
+            if (value.empty() || value.size() > 9 || value.find_first_not_of("0123456789") != std::string::npos
+                || std::stoul(value) == 0) {
+                Outputer::ErrorLn(command) << "Invalid value of " << arg << ": " << value;
+                return false;
+            }
+            (arg == "--depth" ? options.walk.maxDepth : options.maxEntries) = std::stoul(value);
+        }
+    }
+    if (fp.empty()) {
         fp = std::filesystem::current_path().string();
     }
-    Outputer::Out() << fp << std::endl;
-    DrawDirTree(fp, "");
+
+    DirNode pruned;
+    const DirNode* tree;
+    try {
+        // the depth of a summary only limits what is drawn
+        const bool prune = !options.walk.exclude.empty() || (options.walk.maxDepth != 0 && !options.summary);
+        if (prune) {
+            auto walkOptions = options.walk;
+            walkOptions.readSizes = options.summary;
+            walkOptions.maxDepth = options.summary ? 0 : walkOptions.maxDepth;
+            pruned = DirWalker(m_ThreadCount).Walk(fp, walkOptions);
+            tree = &pruned;
+        } else {
+            if (!m_DirTreeCache) {
+                m_DirTreeCache = CreateScope<DirTreeCache>(m_ThreadCount);
+            }
+            tree = &m_DirTreeCache->Get(fp, options.summary);
+        }
+    } catch (const std::exception& e) {
+        Outputer::ErrorLn(command) << e.what();
+        return false;
+    }
+    Outputer::Out() << fp << '\n';
+    DrawDirTree(*tree, options);
 
     return true;
 }
@@ -215,7 +799,7 @@ bool Workspace::HandleLogOn(const Command& command) {
         return false;
     }
     targetEditor->SetLogMode(logMode);
-    m_LogMode = m_CurrentEditor < 0 ? logMode : GetCurrentEditor()->GetLogMode();
+    m_LogMode = !GetCurrentEditor() ? logMode : GetCurrentEditor()->GetLogMode();
 
     return true;
 }
@@ -233,7 +817,7 @@ bool Workspace::HandleLogOff(const Command& command) {
         return false;
     }
     targetEditor->SetLogMode(logMode);
-    m_LogMode = m_CurrentEditor < 0 ? logMode : GetCurrentEditor()->GetLogMode();
+    m_LogMode = !GetCurrentEditor() ? logMode : GetCurrentEditor()->GetLogMode();
 
     return true;
 }
@@ -255,6 +839,200 @@ bool Workspace::HandleLogShow(const Command& command) {
 
     return true;
 }
+bool Workspace::HandleLogLevel(const Command& command) {
+    LogPolicy policy;
+    if (!LogPolicy::Parse(command.GetArgs()[0], policy)) {
+        Outputer::ErrorLn(command) << "Invalid log level, expected all, mutating, sample:<N> or counters:<seconds>";
+        return false;
+    }
+    Ref<Editor> targetEditor;
+    if (command.GetArgs().size() < 2) {
+        targetEditor = GetCurrentEditor();
+    } else {
+        targetEditor = GetEditorByPath(command.GetArgs()[1]);
+    }
+    if (!targetEditor) {
+        Outputer::ErrorLn(command) << "No such editor";
+        return false;
+    }
+    targetEditor->SetLogPolicy(policy);
+
+    return true;
+}
+bool Workspace::HandleExportJson(const Command& command) {
+    const auto path = command.GetArgs().empty() ? std::string("data/.editor_workspace.json") : command.GetArgs()[0];
+    std::filesystem::path fp(path);
+    if (!fp.parent_path().empty() && !std::filesystem::exists(fp.parent_path())) {
+        std::filesystem::create_directories(fp.parent_path());
+    }
+    std::ofstream outFile(path);
+    if (!outFile.is_open()) {
+        Outputer::ErrorLn(command) << "Could not open file: " << path;
+        return false;
+    }
+    outFile << SerializeJson().dump(4);
+    Outputer::InfoLn() << "Exported: " << path;
+    return true;
+}
+
+/**
+ * `session-save [--exit]` writes every loaded or evicted editor with its undo/redo history, so that the next start
+ * resumes without reading the files. edits made afterwards are journaled on top of the image
+ */
+bool Workspace::HandleSessionSave(const Command& command) {
+    const auto& args = command.GetArgs();
+    const bool exitAfter = !args.empty() && args[0] == "--exit";
+    if (!args.empty() && !exitAfter) {
+        Outputer::ErrorLn(command) << "Unknown option: " << args[0];
+        return false;
+    }
+    if (!std::filesystem::exists("data")) {
+        std::filesystem::create_directory("data");
+    }
+    uint32_t editorCount = 0;
+    for (const auto& editor : m_Editors) {
+        editorCount += editor->IsLoaded() || editor->IsEvicted() ? 1 : 0;
+    }
+    // a crash while writing leaves the previous image intact
+    const std::string tempPath = std::string(SessionImagePath) + ".tmp";
+    size_t bytes = 0;
+    {
+        std::ofstream outFile(tempPath, std::ios::binary);
+        if (!outFile.is_open()) {
+            Outputer::ErrorLn(command) << "Could not open file: " << tempPath;
+            return false;
+        }
+        SessionImage::WriteHeader(outFile, SerializeJson(), editorCount);
+        for (const auto& editor : m_Editors) {
+            // the swap file holds the content of an evicted editor already, it is copied without loading it
+            if (editor->IsEvicted()) {
+                EditorSession stamp;
+                stamp.path = editor->GetFilePath();
+                SessionImage::Stamp(stamp);
+                const MappedFile swap(editor->GetSwapPath());
+                SessionImage::WriteEditor(outFile, stamp, swap.GetView());
+            } else if (editor->IsLoaded()) {
+                auto session = editor->CaptureSession();
+                SessionImage::Stamp(session);
+                SessionImage::WriteEditor(outFile, session, SessionImage::SerializeContent(session));
+            }
+        }
+        bytes = static_cast<size_t>(outFile.tellp());
+        if (!outFile) {
+            Outputer::ErrorLn(command) << "Failed to write session: " << tempPath;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, SessionImagePath, ec);
+    if (ec) {
+        Outputer::ErrorLn(command) << "Failed to write session: " << ec.message();
+        return false;
+    }
+    // the image holds every journaled edit now
+    m_Journal->Clear();
+    Outputer::InfoLn() << "Session saved: " << editorCount << " editor(s), " << bytes << " bytes";
+    if (exitAfter) {
+        ExportState();
+        m_Running = false;
+    }
+    return true;
+}
+
+/**
+ * `autosave` prints the settings, `autosave <seconds>` sets the interval and `autosave off` stops it
+ */
+bool Workspace::HandleAutosave(const Command& command) {
+    const auto& args = command.GetArgs();
+    if (args.empty()) {
+        const auto interval = m_Autosave->GetInterval();
+        if (interval.count() == 0) {
+            Outputer::InfoLn() << "Autosave: off";
+        } else {
+            Outputer::InfoLn() << "Autosave: every " << interval.count() << "s, next in "
+                << m_Autosave->GetDelay().count() << "ms, last run took " << m_Autosave->GetLastDuration().count() << "ms";
+        }
+        return true;
+    }
+    if (args[0] == "off") {
+        m_Autosave->SetInterval(std::chrono::seconds(0));
+        return true;
+    }
+    if (args[0].empty() || args[0].find_first_not_of("0123456789") != std::string::npos || args[0].size() > 9) {
+        Outputer::ErrorLn(command) << "Invalid interval: " << args[0];
+        return false;
+    }
+    m_Autosave->SetInterval(std::chrono::seconds(std::stoi(args[0])));
+    return true;
+}
+
+/**
+ * `recover [file]` puts the autosaved content of an editor back, as one undoable change
+ */
+bool Workspace::HandleRecover(const Command& command) {
+    const auto& args = command.GetArgs();
+    const auto target = args.empty() ? GetCurrentEditor() : GetEditorByPath(args[0]);
+    if (!target) {
+        Outputer::ErrorLn(command) << (args.empty() ? "No current editor" : "File not opened: " + args[0]);
+        return false;
+    }
+    std::vector<std::string> lines;
+    if (!AutosaveService::ReadRecoveryFile(target->GetCanonicalPath(), lines)) {
+        Outputer::ErrorLn(command) << "No autosaved content for " << target->GetFilePath();
+        return false;
+    }
+    try {
+        target->ReplaceContent(std::move(lines));
+    } catch (const std::exception& e) {
+        Outputer::ErrorLn(command) << "Failed to load file: " << e.what();
+        return false;
+    }
+    Outputer::InfoLn() << "Recovered " << target->GetLines().size() << " line(s): " << target->GetFilePath();
+    return true;
+}
+
+/**
+ * `mem-budget` prints the budget and what is resident, `mem-budget <bytes>[K|M|G]` sets it, `mem-budget off` drops it
+ */
+bool Workspace::HandleMemBudget(const Command& command) {
+    const auto& args = command.GetArgs();
+    if (args.empty()) {
+        size_t resident = 0, evicted = 0;
+        for (const auto& editor : m_Editors) {
+            resident += editor->GetResidentBytes();
+            evicted += editor->IsEvicted() ? 1 : 0;
+        }
+        Outputer::InfoLn() << "Memory budget: " << (m_MemoryBudget == 0 ? std::string("off") : std::to_string(m_MemoryBudget) + " B")
+            << ", resident " << resident << " B, " << evicted << " editor(s) evicted";
+        return true;
+    }
+    if (args[0] == "off") {
+        m_MemoryBudget = 0;
+        return true;
+    }
+    const auto digits = args[0].find_first_not_of("0123456789");
+    const std::string suffix = digits == std::string::npos ? "" : args[0].substr(digits);
+    size_t unit = 1;
+    if (suffix == "K" || suffix == "k") {
+        unit = 1024;
+    } else if (suffix == "M" || suffix == "m") {
+        unit = 1024 * 1024;
+    } else if (suffix == "G" || suffix == "g") {
+        unit = 1024 * 1024 * 1024;
+    } else if (!suffix.empty()) {
+        unit = 0;
+    }
+    const auto digitCount = digits == std::string::npos ? args[0].size() : digits;
+    if (digitCount == 0 || digitCount > 12 || unit == 0) {
+        Outputer::ErrorLn(command) << "Invalid budget: " << args[0];
+        return false;
+    }
+    m_MemoryBudget = std::stoull(args[0].substr(0, digitCount)) * unit;
+    // a lower budget applies right away, not only after the next command
+    EnforceMemoryBudget();
+    return true;
+}
+
 bool Workspace::HandleExit(const Command& command) {
     for (const auto& editor : m_Editors) {
         if (editor->IsModified()) {
@@ -262,66 +1040,144 @@ bool Workspace::HandleExit(const Command& command) {
         }
     }
     ExportState();
+    // every buffer was either saved or deliberately left unsaved
+    m_Journal->Clear();
+    std::error_code ec;
+    std::filesystem::remove(SessionImagePath, ec);
+    AutosaveService::RemoveAllRecoveryFiles();
     m_Running = false;
 
     return true;
 }
 
 /**
- * @return -1 when no editors
+ * @return InvalidEditor when no editors
  */
-int Workspace::GetLastEditorIndex() const{
-    long long tp = 0;
-    int index = -1;
-    for (int i = 0; i < m_Editors.size(); i++){
-        const auto current = m_Editors[i]->GetLastTime().time_since_epoch().count();
-        if (current > tp){
-            tp = current;
-            index = i;
-        }
-    }
-    return index;
+Workspace::EditorHandle Workspace::GetLastEditorHandle() const{
+    const auto editor = m_RecentEditors.Front();
+    if (!editor)
+        return InvalidEditor;
+    return m_EditorByPath.at(editor->GetCanonicalPath());
+}
+
+void Workspace::ExportState() {
+    WriteState(SerializeJson(), ++m_StateGeneration);
 }
 
-void Workspace::ExportState() const {
-    nlohmann::json statusJson = SerializeJson();
-    const auto jsonString = statusJson.dump(4);
+/**
+ * states are written in the order they were taken, an autosave that raced with `exit` does not
+ * overwrite the newer state
+ */
+void Workspace::WriteState(const nlohmann::json& state, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_StateFileMutex);
+    if (generation < m_WrittenStateGeneration)
+        return;
+    m_WrittenStateGeneration = generation;
+    // binary, so starting up does not pay for parsing text
+    const auto bytes = nlohmann::json::to_msgpack(state);
     if (!std::filesystem::exists("data")) {
         std::filesystem::create_directory("data");
     }
-    std::ofstream outFile("data/.editor_workspace");
+    std::ofstream outFile("data/.editor_workspace", std::ios::binary);
     if (!outFile.is_open()) {
         Outputer::InfoLn() << "Failed to update workspace file";
         return;
     }
-    outFile << jsonString;
+    outFile.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
     outFile.close();
 }
 
+void Workspace::Autosave() {
+    std::lock_guard<std::mutex> autosaveLock(m_AutosaveMutex);
+    nlohmann::json state;
+    uint64_t generation;
+    std::vector<std::tuple<std::string, uint64_t, std::vector<std::string>>> changed;
+    std::vector<std::string> clean;
+    {
+        // only copying happens under the command lock, writing does not block commands
+        std::lock_guard<std::mutex> lock(m_CommandMutex);
+        state = SerializeJson();
+        generation = ++m_StateGeneration;
+        // counters intervals end on time even while no command comes in
+        const auto now = std::chrono::system_clock::now();
+        if (m_Logger) {
+            m_Logger->FlushDueCounters(now);
+        }
+        for (const auto& editor : m_Editors) {
+            if (editor->GetLogger()) {
+                editor->GetLogger()->FlushDueCounters(now);
+            }
+            if (!editor->IsLoaded())
+                continue;
+            const auto& path = editor->GetCanonicalPath();
+            if (!editor->IsModified()) {
+                if (m_AutosavedRevisions.erase(path)) {
+                    clean.push_back(path);
+                }
+                continue;
+            }
+            const auto it = m_AutosavedRevisions.find(path);
+            if (it != m_AutosavedRevisions.end() && it->second == editor->GetRevision())
+                continue;
+            changed.emplace_back(path, editor->GetRevision(), editor->GetLines());
+        }
+    }
+    WriteState(state, generation);
+    for (const auto& [path, revision, lines] : changed) {
+        if (AutosaveService::WriteRecoveryFile(path, lines)) {
+            m_AutosavedRevisions[path] = revision;
+        } else {
+            Outputer::InfoLn() << "Failed to autosave `" << path << "`";
+        }
+    }
+    // saved since the last run, the recovery file is obsolete
+    for (const auto& path : clean) {
+        AutosaveService::RemoveRecoveryFile(path);
+    }
+}
+
 nlohmann::json Workspace::SerializeJson() const {
     nlohmann::json j;
     j["log_mode"] = m_LogMode;
     j["current_editor"] = m_CurrentEditor;
-    for (const auto& editor : m_Editors) {
+    for (const auto handle : m_Editors.GetHandlesInInsertionOrder()) {
+        const auto& editor = *m_Editors.Get(handle);
         nlohmann::json editorJson;
+        editorJson["handle"] = handle;
         editorJson["path"] = editor->GetFilePath();
         editorJson["modified"] = editor->IsModified();
         editorJson["log_mode"] = editor->GetLogMode();
+        editorJson["log_policy"] = editor->GetLogPolicy().ToString();
         j["editors"].push_back(editorJson);
     }
+    j["autosave_interval"] = m_Autosave->GetInterval().count();
+    j["memory_budget"] = m_MemoryBudget;
     return j;
 }
 
 void Workspace::DeserializeJson(const nlohmann::json& j) {
-    m_Editors.clear();
-    m_CurrentEditor = -1;
+    while (!m_RecentEditors.Empty()) {
+        m_RecentEditors.Remove(m_RecentEditors.Front());
+    }
+    m_Editors.Clear();
+    m_EditorByPath.clear();
+    m_CurrentEditor = InvalidEditor;
     if (j.contains("log_mode")) {
         m_LogMode = j["log_mode"].get<LogMode>();
     } else {
         m_LogMode = LogMode::None;
     }
+    if (j.contains("memory_budget") && j["memory_budget"].is_number_unsigned()) {
+        m_MemoryBudget = j["memory_budget"].get<size_t>();
+    }
+    if (j.contains("autosave_interval") && j["autosave_interval"].is_number_integer()) {
+        m_RestoredAutosaveInterval = std::chrono::seconds(j["autosave_interval"].get<int64_t>());
+    }
+    // handles are given out again, `current_editor` is mapped onto the new ones.
+    // states without per-editor handles stored the position of the current editor
+    EditorHandle savedCurrent = InvalidEditor;
     if (j.contains("current_editor")) {
-        m_CurrentEditor = j["current_editor"].get<int>();
+        savedCurrent = j["current_editor"].get<EditorHandle>();
     }
     if (!j.contains("editors") || j["editors"].empty() || !j["editors"].is_array()) {
         return;
@@ -339,27 +1195,44 @@ void Workspace::DeserializeJson(const nlohmann::json& j) {
             Outputer::InfoLn() << "Invalid editor configure: missing token `modified`";
             continue;
         }
-        CreateEditorByFilePath(editorJson["path"].get<std::string>());
-        auto current = m_Editors.back();
-        current->SetLogMode(editorJson["log_mode"].get<LogMode>());
-        current->SetModified(editorJson["modified"].get<bool>());
+        if (GetEditorHandleByPath(editorJson["path"].get<std::string>()) != InvalidEditor) {
+            Outputer::InfoLn() << "Duplicated editor configure: " << editorJson["path"].get<std::string>();
+            continue;
+        }
+        const auto position = static_cast<EditorHandle>(m_Editors.Size());
+        // the file is read when the editor is first shown, edited or saved
+        auto current = Editor::CreateUnloaded(editorJson["path"].get<std::string>(),
+            editorJson["log_mode"].get<LogMode>(), editorJson["modified"].get<bool>());
+        current->SetJournal(m_Journal);
+        const auto handle = AddEditor(current);
+        if (editorJson.contains("handle") ? editorJson["handle"] == savedCurrent : position == savedCurrent) {
+            m_CurrentEditor = handle;
+        }
+        if (LogPolicy policy; editorJson.contains("log_policy") && editorJson["log_policy"].is_string()
+            && LogPolicy::Parse(editorJson["log_policy"].get<std::string>(), policy)) {
+            current->SetLogPolicy(policy);
+        }
         Outputer::InfoLn() << "Loaded: " << current->GetFilePath();
     }
 }
 
-Ref<Editor> Workspace::GetEditorByPath(const std::string& path) const
+Ref<Editor> Workspace::GetEditorByPath(const std::string& ref) const
 {
-    for (const auto& editor : m_Editors) {
-        if (editor->GetFilePath() == path) { return editor; }
-    }
-    return nullptr;
+    const auto editor = m_Editors.Get(GetEditorHandleByPath(ref));
+    return editor ? *editor : nullptr;
 }
 
-int Workspace::GetEditorIndexByPath(const std::string& path) const {
-    for (int i = 0; i < m_Editors.size(); i++){
-        if (m_Editors[i]->GetFilePath() == path) { return i; }
+Workspace::EditorHandle Workspace::GetEditorHandleByPath(const std::string& ref) const {
+    if (ref.size() > 1 && ref[0] == '#' && ref.find_first_not_of("0123456789", 1) == std::string::npos) {
+        try {
+            const auto handle = std::stoll(ref.substr(1));
+            return m_Editors.Contains(handle) ? handle : InvalidEditor;
+        } catch (const std::exception&) {
+            return InvalidEditor;
+        }
     }
-    return -1;
+    const auto it = m_EditorByPath.find(CanonicalizePath(ref));
+    return it == m_EditorByPath.end() ? InvalidEditor : it->second;
 }
 
 void Workspace::UpdateLogMode(const LogMode logMode) {
@@ -1,34 +1,63 @@
 // Workspace.h
 
 #pragma once
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "nlohmann/json.hpp"
 
 #include "Core.h"
+#include "SlotMap.h"
+#include "ThreadPool.h"
 #include "Command.h"
 #include "Logging.h"
 #include "Editor.h"
+#include "EditJournal.h"
+#include "SessionImage.h"
+#include "DirTreeCache.h"
+#include "FileSearch.h"
+#include "AutosaveService.h"
 #include "CommandExecuting.h"
 
 
 class Workspace : public CommandExecutor{
 public:
-	explicit Workspace(const std::string& workspaceData);
-	~Workspace() override = default;
+	using EditorHandle = SlotMap<Ref<Editor>>::Handle;
+	static constexpr EditorHandle InvalidEditor = SlotMap<Ref<Editor>>::InvalidHandle;
+	static constexpr const char* SessionImagePath = "data/.editor_session";
+	static constexpr const char* DefaultJournalPath = "data/.edit_journal";
+
+	// `workspaceData` is a state written by ExportState, or the same state as JSON.
+	// unsaved edits are journaled to `journalPath` and recovered from it on start
+	explicit Workspace(std::string_view workspaceData, const std::string& journalPath = DefaultJournalPath);
+	~Workspace() override;
 
 	Ref<Editor> GetCurrentEditor() {
-		if (m_CurrentEditor < 0 || m_CurrentEditor >= m_Editors.size())
-			return nullptr;
-		return m_Editors[m_CurrentEditor];
+		const auto editor = m_Editors.Get(m_CurrentEditor);
+		return editor ? *editor : nullptr;
 	}
-	int GetCurrentEditorIndex() const { return m_CurrentEditor; }
+	EditorHandle GetCurrentEditorHandle() const { return m_CurrentEditor; }
 	LogMode GetLogMode() const { return m_LogMode; }
 
 	void Handle(const Command& command) override;
 
 	bool GetRunning() const { return m_Running; }
+	// number of threads files are read with, takes effect on the next parallel load
+	void SetThreadCount(size_t threadCount);
+	// held while a command runs, the autosave thread takes it to copy what it writes
+	std::mutex& GetCommandMutex() { return m_CommandMutex; }
+	std::chrono::seconds GetAutosaveInterval() const { return m_Autosave->GetInterval(); }
+	// evicts the least recently used editors, except the current one, until the
+	// resident content fits the budget set by `mem-budget`
+	void EnforceMemoryBudget();
+	size_t GetMemoryBudget() const { return m_MemoryBudget; }
+	// writes the state and a recovery file per editor changed since the last run.
+	// called by the autosave thread, or directly when no command is running
+	void Autosave();
 protected:
 	void RegisterCommandHandlingStrategies() override;
 private:
@@ -42,26 +71,69 @@ private:
 	bool HandleLogOn      (const Command& command);
 	bool HandleLogOff     (const Command& command);
 	bool HandleLogShow    (const Command& command);
+	bool HandleLogLevel   (const Command& command);
+	bool HandleExportJson (const Command& command);
+	bool HandleSessionSave(const Command& command);
+	bool HandleAutosave   (const Command& command);
+	bool HandleRecover    (const Command& command);
+	bool HandleMemBudget  (const Command& command);
+	bool HandleReplaceAll (const Command& command);
+	bool HandleSearch     (const Command& command);
+	bool HandleGrep       (const Command& command);
 	bool HandleExit       (const Command& command);
 
-	void CreateEditorByFilePath(const std::string& fp);
-	int GetLastEditorIndex() const;
+	EditorHandle CreateEditorByFilePath(const std::string& fp);
+	// `load @N`, opens the file of a hit of the last `grep` and shows the hit
+	bool LoadHit(const Command& command, const std::string& hitText);
+	// reads the files concurrently and registers their editors in the order of `paths`,
+	// paths already open map to their editor, failed ones to InvalidEditor
+	std::vector<EditorHandle> OpenEditors(const std::vector<std::string>& paths);
+	void LoadEditors(const std::vector<EditorHandle>& handles);
+	ThreadPool& GetThreadPool();
+	// writes the modified editors on at most `concurrency` threads and prints one report
+	bool SaveAll(const Command& command, size_t concurrency);
+	EditorHandle AddEditor(const Ref<Editor>& editor);
+	void RemoveEditor(EditorHandle handle);
+	void RecoverFromJournal();
+	void RestoreSession(SessionImage& image);
+	EditorHandle GetLastEditorHandle() const;
 
-	void ExportState() const ;
+	void ExportState();
+	void WriteState(const nlohmann::json& state, uint64_t generation);
 	nlohmann::json SerializeJson() const;
 	void DeserializeJson(const nlohmann::json& j);
-	Ref<Editor> GetEditorByPath(const std::string& path) const;
-	int GetEditorIndexByPath(const std::string& path) const;
+	// `ref` is either a file path or `#<handle>` as printed by editor-list
+	Ref<Editor> GetEditorByPath(const std::string& ref) const;
+	EditorHandle GetEditorHandleByPath(const std::string& ref) const;
 	void UpdateLogMode(LogMode logMode);
 
 private:
 	// using CommandStrategy = bool (Workspace::*)(const Command&);
 	// static const std::unordered_map<Command::Type, CommandStrategy> s_HandlerMethods;
 	CommandDispatcher<Workspace> m_Dispatcher;
-	int m_CurrentEditor;
-	std::vector<Ref<Editor>> m_Editors;
+	EditorHandle m_CurrentEditor;
+	SlotMap<Ref<Editor>> m_Editors;
+	std::unordered_map<std::string, EditorHandle> m_EditorByPath; // keyed by canonical path
+	MruList<Editor> m_RecentEditors; // touched by Editor::UpdateTime
 	bool m_Running = true;
 	LogMode m_LogMode;
 	Scope<Logger> m_Logger;
+	Ref<EditJournal> m_Journal;
+	Scope<ThreadPool> m_ThreadPool; // created on first use
+	Scope<ThreadPool> m_IoPool; // sized by the concurrency of the last `save all`
+	Scope<DirTreeCache> m_DirTreeCache; // created on first `dir-tree` or `grep`
+	FileSearchResult m_LastGrep; // for `load @N`
+	size_t m_MemoryBudget = 0; // bytes, 0 for no budget
+	std::chrono::seconds m_RestoredAutosaveInterval{0}; // from the state, applied when construction is done
+	size_t m_ThreadCount = ThreadPool::DefaultThreadCount();
+
+	std::mutex m_CommandMutex;
+	std::mutex m_AutosaveMutex; // one autosave at a time
+	std::mutex m_StateFileMutex;
+	uint64_t m_StateGeneration = 0; // bumped by every export, under m_CommandMutex
+	uint64_t m_WrittenStateGeneration = 0; // under m_StateFileMutex
+	std::unordered_map<std::string, uint64_t> m_AutosavedRevisions; // canonical path -> revision, under m_AutosaveMutex
+	// last, so that its thread is stopped before anything it uses goes away
+	Scope<AutosaveService> m_Autosave;
 };
 
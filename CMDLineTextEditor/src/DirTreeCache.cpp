@@ -0,0 +1,327 @@
+#include "DirTreeCache.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "Editor.h"
+
+namespace {
+
+std::string JoinRelative(const std::string& relative, const std::string& name) {
+    return relative.empty() ? name : relative + '/' + name;
+}
+
+// the node of a directory below `tree`, nullptr when it is gone
+DirNode* FindNode(DirNode& tree, const std::string& relative) {
+    DirNode* node = &tree;
+    size_t begin = 0;
+    while (node && begin < relative.size()) {
+        auto end = relative.find('/', begin);
+        if (end == std::string::npos) {
+            end = relative.size();
+        }
+        const auto name = relative.substr(begin, end - begin);
+        const auto it = std::lower_bound(node->children.begin(), node->children.end(), name,
+            [](const DirNode& child, const std::string& value) { return child.name < value; });
+        node = it != node->children.end() && it->name == name && it->isDirectory ? &*it : nullptr;
+        begin = end + 1;
+    }
+    return node;
+}
+
+#ifdef __linux__
+uint32_t GetWatchMask(bool sizes) {
+    // IN_MASK_ADD keeps what other roots asked for on the same directory
+    return IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW
+        | (sizes ? IN_MODIFY | IN_CLOSE_WRITE : 0) | IN_MASK_ADD;
+}
+#endif
+
+int64_t GetModifiedTime(const std::string& path) {
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? -1 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+DirTreeCache::DirTreeCache(size_t threadCount, bool useInotify)
+    : m_Walker(threadCount)
+{
+#ifdef __linux__
+    if (useInotify) {
+        m_InotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    }
+#else
+    (void)useInotify;
+#endif
+}
+
+DirTreeCache::~DirTreeCache() {
+#ifdef __linux__
+    if (m_InotifyFd >= 0) {
+        close(m_InotifyFd);
+    }
+#endif
+}
+
+const DirNode& DirTreeCache::Get(const std::string& root, bool withSizes) {
+    const auto key = CanonicalizePath(root);
+    ReadEvents();
+    auto [it, inserted] = m_Roots.try_emplace(key);
+    auto& cached = it->second;
+    try {
+        if (inserted || (withSizes && !cached.sizes)) {
+            cached.path = inserted ? root : cached.path;
+            cached.sizes = cached.sizes || withSizes;
+            Walk(key, cached);
+        } else {
+            Refresh(key, cached);
+        }
+    } catch (...) {
+        Untrack(key, cached, "");
+        m_Roots.erase(it);
+        throw;
+    }
+    return cached.tree;
+}
+
+void DirTreeCache::Clear() {
+    for (auto& [key, root] : m_Roots) {
+        Untrack(key, root, "");
+    }
+    m_Roots.clear();
+}
+
+bool DirTreeCache::IsPolling(const std::string& root) const {
+    const auto it = m_Roots.find(CanonicalizePath(root));
+    return it != m_Roots.end() && it->second.polling;
+}
+
+void DirTreeCache::Walk(const std::string& key, CachedRoot& root) {
+    Untrack(key, root, "");
+    root.stale = false;
+    root.staleDirectories.clear();
+    root.modifiedTimes.clear();
+    DirWalkOptions options;
+    options.readSizes = root.sizes;
+    root.tree = m_Walker.Walk(root.path, options);
+    m_Stats.fullWalks++;
+    Track(key, root, "", root.tree);
+}
+
+void DirTreeCache::Refresh(const std::string& key, CachedRoot& root) {
+    if (root.stale) {
+        Walk(key, root);
+        return;
+    }
+    if (root.polling) {
+        PollChanges(root, "", root.tree);
+    }
+    // parents sort before their children, a child dropped by its parent's refresh is skipped
+    const auto staleDirectories = std::move(root.staleDirectories);
+    root.staleDirectories.clear();
+    for (const auto& relative : staleDirectories) {
+        if (auto* node = FindNode(root.tree, relative)) {
+            RefreshDirectory(key, root, relative, *node);
+        }
+    }
+    if (!std::filesystem::is_directory(root.path)) {
+        throw std::runtime_error("Not a directory: " + root.path);
+    }
+}
+
+void DirTreeCache::RefreshDirectory(const std::string& key, CachedRoot& root, const std::string& relative, DirNode& node) {
+    const auto path = relative.empty() ? root.path : DirWalker::JoinPath(root.path, relative);
+    auto previous = std::move(node.children);
+    DirWalker::ReadDirectory(path, node, root.sizes);
+    m_Stats.refreshedDirectories++;
+    // subtrees of directories that are still there are kept, they have watches of their own. a directory
+    // removed and made again, or replaced by a rename, has the same name but not the same watch
+    auto old = previous.begin();
+    for (auto& child : node.children) {
+        while (old != previous.end() && old->name < child.name) {
+            if (old->isDirectory) {
+                Untrack(key, root, JoinRelative(relative, old->name));
+            }
+            ++old;
+        }
+        if (old != previous.end() && old->name == child.name && old->isDirectory && child.isDirectory
+            && IsWatched(root, JoinRelative(relative, child.name))) {
+            child = std::move(*old);
+            ++old;
+            continue;
+        }
+        if (old != previous.end() && old->name == child.name) {
+            if (old->isDirectory) {
+                Untrack(key, root, JoinRelative(relative, old->name));
+            }
+            ++old;
+        }
+        if (child.isDirectory) {
+            auto name = std::move(child.name);
+            DirWalkOptions options;
+            options.readSizes = root.sizes;
+            child = m_Walker.Walk(DirWalker::JoinPath(path, name), options);
+            child.name = std::move(name);
+            Track(key, root, JoinRelative(relative, child.name), child);
+        }
+    }
+    for (; old != previous.end(); ++old) {
+        if (old->isDirectory) {
+            Untrack(key, root, JoinRelative(relative, old->name));
+        }
+    }
+}
+
+/**
+ * @return whether the watch of a cached directory still watches the directory now at its path
+ */
+bool DirTreeCache::IsWatched(const CachedRoot& root, const std::string& relative) const {
+    if (root.polling)
+        return true; // a directory made again has a modification time of its own
+#ifdef __linux__
+    const auto it = root.watches.find(relative);
+    if (it == root.watches.end())
+        return false;
+    // adding a watch again gives the descriptor the inode already has, so another one means another inode
+    const auto path = DirWalker::JoinPath(root.path, relative);
+    return inotify_add_watch(m_InotifyFd, path.c_str(), GetWatchMask(root.sizes)) == it->second;
+#else
+    return true;
+#endif
+}
+
+void DirTreeCache::Track(const std::string& key, CachedRoot& root, const std::string& relative, const DirNode& node) {
+    if (!TrackSubtree(key, root, relative, node)) {
+        StartPolling(key, root);
+    }
+}
+
+/**
+ * @return false when a watch could not be added, usually because the user ran out of them
+ */
+bool DirTreeCache::TrackSubtree(const std::string& key, CachedRoot& root, const std::string& relative, const DirNode& node) {
+    const auto path = relative.empty() ? root.path : DirWalker::JoinPath(root.path, relative);
+    if (root.polling) {
+        root.modifiedTimes[relative] = GetModifiedTime(path);
+    } else {
+#ifdef __linux__
+        if (m_InotifyFd < 0)
+            return false;
+        const int watch = inotify_add_watch(m_InotifyFd, path.c_str(), GetWatchMask(root.sizes));
+        if (watch < 0)
+            return false;
+        root.watches[relative] = watch;
+        m_WatchTargets[watch].emplace_back(key, relative);
+#else
+        return false;
+#endif
+    }
+    for (const auto& child : node.children) {
+        if (child.isDirectory && !TrackSubtree(key, root, JoinRelative(relative, child.name), child))
+            return false;
+    }
+    return true;
+}
+
+void DirTreeCache::Untrack(const std::string& key, CachedRoot& root, const std::string& relative) {
+    // the directory itself, then everything below it
+    const auto prefix = relative.empty() ? std::string() : relative + '/';
+    const auto inSubtree = [&](const std::string& path) {
+        return path == relative || path.compare(0, prefix.size(), prefix) == 0;
+    };
+    const auto removeWatch = [&](std::map<std::string, int>::iterator it) {
+        auto& targets = m_WatchTargets[it->second];
+        const std::pair<std::string, std::string> target(key, it->first);
+        targets.erase(std::remove(targets.begin(), targets.end(), target), targets.end());
+        if (targets.empty()) {
+            m_WatchTargets.erase(it->second);
+#ifdef __linux__
+            inotify_rm_watch(m_InotifyFd, it->second);
+#endif
+        }
+        return root.watches.erase(it);
+    };
+    if (const auto it = root.watches.find(relative); it != root.watches.end()) {
+        removeWatch(it);
+    }
+    for (auto it = root.watches.lower_bound(prefix); it != root.watches.end() && inSubtree(it->first);) {
+        it = removeWatch(it);
+    }
+    root.modifiedTimes.erase(relative);
+    for (auto it = root.modifiedTimes.lower_bound(prefix); it != root.modifiedTimes.end() && inSubtree(it->first);) {
+        it = root.modifiedTimes.erase(it);
+    }
+}
+
+void DirTreeCache::StartPolling(const std::string& key, CachedRoot& root) {
+    Untrack(key, root, "");
+    root.polling = true;
+    TrackSubtree(key, root, "", root.tree);
+}
+
+void DirTreeCache::PollChanges(CachedRoot& root, const std::string& relative, const DirNode& node) {
+    const auto path = relative.empty() ? root.path : DirWalker::JoinPath(root.path, relative);
+    const auto modified = GetModifiedTime(path);
+    auto& known = root.modifiedTimes[relative];
+    if (known != modified) {
+        known = modified;
+        root.staleDirectories.insert(relative);
+    }
+    for (const auto& child : node.children) {
+        if (child.isDirectory) {
+            PollChanges(root, JoinRelative(relative, child.name), child);
+        }
+    }
+}
+
+void DirTreeCache::ReadEvents() {
+#ifdef __linux__
+    if (m_InotifyFd < 0)
+        return;
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        const auto length = read(m_InotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->mask & IN_Q_OVERFLOW) {
+                // events were dropped, nothing cached can be trusted
+                for (auto& [key, root] : m_Roots) {
+                    root.stale = true;
+                }
+                continue;
+            }
+            const auto targets = m_WatchTargets.find(event->wd);
+            if (targets == m_WatchTargets.end())
+                continue;
+            for (const auto& [key, relative] : targets->second) {
+                const auto root = m_Roots.find(key);
+                if (root != m_Roots.end()) {
+                    root->second.staleDirectories.insert(relative);
+                }
+            }
+            if (event->mask & IN_IGNORED) {
+                // the directory is gone, its parent's refresh drops it from the tree, or walks it
+                // again and watches it anew when one of the same name took its place
+                for (const auto& [key, relative] : targets->second) {
+                    const auto root = m_Roots.find(key);
+                    if (root != m_Roots.end()) {
+                        root->second.watches.erase(relative);
+                    }
+                }
+                m_WatchTargets.erase(targets);
+            }
+        }
+    }
+#endif
+}
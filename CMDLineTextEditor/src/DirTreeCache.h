@@ -0,0 +1,70 @@
+// DirTreeCache.h
+
+#pragma once
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "DirWalker.h"
+
+// keeps the tree of every walked root in memory and reads again only the directories that
+// changed. on Linux an inotify watch per directory reports the changes; elsewhere, or once
+// the watches run out, every cached directory is checked by its modification time instead.
+// file sizes, once asked for, are kept up to date by the same refreshes; when polling, a file
+// written in place is only seen once its directory changes
+class DirTreeCache {
+public:
+    struct Stats {
+        size_t fullWalks = 0;
+        size_t refreshedDirectories = 0;
+    };
+
+    explicit DirTreeCache(size_t threadCount = ThreadPool::DefaultThreadCount(), bool useInotify = true);
+    ~DirTreeCache();
+    DirTreeCache(const DirTreeCache&) = delete;
+    DirTreeCache& operator=(const DirTreeCache&) = delete;
+
+    // walked on first use, refreshed where it changed since the last call.
+    // throws when `root` is not a readable directory
+    const DirNode& Get(const std::string& root, bool withSizes = false);
+    void Clear();
+    const Stats& GetStats() const { return m_Stats; }
+    // whether changes under `root` are found by polling modification times
+    bool IsPolling(const std::string& root) const;
+
+private:
+    struct CachedRoot {
+        std::string path; // as first walked
+        DirNode tree;
+        bool polling = false;
+        bool stale = false; // walk everything again
+        bool sizes = false; // files carry their sizes
+        std::set<std::string> staleDirectories; // relative to the root, "" is the root itself
+        std::map<std::string, int> watches; // relative directory -> watch descriptor
+        std::map<std::string, int64_t> modifiedTimes; // relative directory -> mtime, when polling
+    };
+
+    void Walk(const std::string& key, CachedRoot& root);
+    void Refresh(const std::string& key, CachedRoot& root);
+    void RefreshDirectory(const std::string& key, CachedRoot& root, const std::string& relative, DirNode& node);
+    bool IsWatched(const CachedRoot& root, const std::string& relative) const;
+    // starts or stops following the changes of a directory and everything below it
+    void Track(const std::string& key, CachedRoot& root, const std::string& relative, const DirNode& node);
+    bool TrackSubtree(const std::string& key, CachedRoot& root, const std::string& relative, const DirNode& node);
+    void Untrack(const std::string& key, CachedRoot& root, const std::string& relative);
+    void StartPolling(const std::string& key, CachedRoot& root);
+    void PollChanges(CachedRoot& root, const std::string& relative, const DirNode& node);
+    void ReadEvents();
+
+private:
+    DirWalker m_Walker;
+    std::unordered_map<std::string, CachedRoot> m_Roots; // keyed by canonical path
+    Stats m_Stats;
+    int m_InotifyFd = -1;
+    // a directory under several cached roots has one watch for all of them
+    std::unordered_map<int, std::vector<std::pair<std::string, std::string>>> m_WatchTargets;
+};
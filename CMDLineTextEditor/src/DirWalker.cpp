@@ -0,0 +1,287 @@
+#include "DirWalker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "Core.h"
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+struct DirTask {
+    DirNode* node;
+    std::string path;
+    size_t depth;
+};
+
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<DirTask> tasks;
+};
+
+#ifndef _WIN32
+// type and size of an entry of an open directory, without following links
+bool StatEntry(int dir, const char* name, bool& isDirectory, uint64_t& size) {
+#if defined(__linux__) && defined(STATX_SIZE)
+    static std::atomic<bool> hasStatx{true};
+    if (hasStatx.load(std::memory_order_relaxed)) {
+        struct statx stx {};
+        if (statx(dir, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE, &stx) == 0) {
+            isDirectory = S_ISDIR(stx.stx_mode);
+            size = isDirectory ? 0 : stx.stx_size;
+            return true;
+        }
+        if (errno != ENOSYS)
+            return false;
+        hasStatx = false;
+    }
+#endif
+    struct stat st {};
+    if (fstatat(dir, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+    isDirectory = S_ISDIR(st.st_mode);
+    size = isDirectory ? 0 : static_cast<uint64_t>(st.st_size);
+    return true;
+}
+#endif
+
+// fills node.children with the entries of `path`, unsorted
+void ReadEntries(const std::string& path, DirNode& node, bool readSizes) {
+#ifdef _WIN32
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        auto& child = node.children.emplace_back();
+        child.name = it->path().filename().string();
+        // filled in by the directory enumeration, no extra stat on Windows
+        child.isDirectory = it->is_directory(ec) && !it->is_symlink(ec);
+        if (readSizes && !child.isDirectory && it->is_regular_file(ec)) {
+            child.size = it->file_size(ec);
+        }
+    }
+    if (ec) {
+        node.error = ec.message();
+    }
+#else
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        node.error = std::string(std::strerror(errno)) + ": " + path;
+        return;
+    }
+    while (const dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+            continue;
+        auto& child = node.children.emplace_back();
+        child.name = name;
+        if (entry->d_type != DT_UNKNOWN) {
+            child.isDirectory = entry->d_type == DT_DIR;
+            if (!readSizes || child.isDirectory)
+                continue;
+        }
+        // some file systems leave the type out
+        StatEntry(dirfd(dir), name, child.isDirectory, child.size);
+    }
+    closedir(dir);
+#endif
+}
+
+// matches a `[...]` set at the start of `pattern` against `c`, returns the length of the set or 0 when malformed
+size_t MatchSet(std::string_view pattern, char c, bool& matched) {
+    size_t i = 1;
+    const bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+    if (negated) {
+        i++;
+    }
+    matched = false;
+    for (bool first = true; i < pattern.size() && (first || pattern[i] != ']'); first = false) {
+        if (i + 2 < pattern.size() && pattern[i + 1] == '-' && pattern[i + 2] != ']') {
+            matched = matched || (pattern[i] <= c && c <= pattern[i + 2]);
+            i += 3;
+        } else {
+            matched = matched || pattern[i] == c;
+            i++;
+        }
+    }
+    if (i >= pattern.size())
+        return 0;
+    matched = matched != negated;
+    return i + 1;
+}
+
+} // namespace
+
+bool MatchGlob(std::string_view pattern, std::string_view name) {
+    // on a mismatch, the last `*` takes one more character and the match resumes after it
+    size_t p = 0, n = 0;
+    size_t starPattern = std::string_view::npos, starName = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && pattern[p] == '*') {
+            starPattern = ++p;
+            starName = n;
+            continue;
+        }
+        if (p < pattern.size()) {
+            if (pattern[p] == '[') {
+                bool matched;
+                const auto length = MatchSet(pattern.substr(p), name[n], matched);
+                if (length && matched) {
+                    p += length;
+                    n++;
+                    continue;
+                }
+                if (!length && name[n] == '[') {
+                    p++;
+                    n++;
+                    continue;
+                }
+            } else if (pattern[p] == '?' || pattern[p] == name[n]) {
+                p++;
+                n++;
+                continue;
+            }
+        }
+        if (starPattern == std::string_view::npos)
+            return false;
+        p = starPattern;
+        n = ++starName;
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        p++;
+    }
+    return p == pattern.size();
+}
+
+bool MatchAnyGlob(const std::vector<std::string>& patterns, std::string_view name) {
+    return std::any_of(patterns.begin(), patterns.end(),
+        [name](const std::string& pattern) { return MatchGlob(pattern, name); });
+}
+
+void DirWalker::ReadDirectory(const std::string& path, DirNode& node, bool readSizes) {
+    node.children.clear();
+    node.error.clear();
+    ReadEntries(path, node, readSizes);
+    std::sort(node.children.begin(), node.children.end(),
+        [](const DirNode& a, const DirNode& b) { return a.name < b.name; });
+}
+
+std::string DirWalker::JoinPath(const std::string& parent, const std::string& name) {
+    if (!parent.empty() && (parent.back() == '/' || parent.back() == '\\'))
+        return parent + name;
+    return parent + '/' + name;
+}
+
+DirWalker::DirWalker(size_t threadCount)
+    : m_ThreadCount(std::max<size_t>(threadCount, 1))
+{
+}
+
+DirNode DirWalker::Walk(const std::string& root, const DirWalkOptions& options) const {
+    if (!std::filesystem::is_directory(root)) {
+        throw std::runtime_error("Not a directory: " + root);
+    }
+    DirNode rootNode;
+    rootNode.name = root;
+    rootNode.isDirectory = true;
+
+    std::vector<Scope<WorkQueue>> queues;
+    for (size_t i = 0; i < m_ThreadCount; i++) {
+        queues.push_back(CreateScope<WorkQueue>());
+    }
+    // directories queued or being read, the walk is over when it drops to zero
+    std::atomic<size_t> pending{1};
+    queues[0]->tasks.push_back(DirTask{&rootNode, root, 0});
+    // workers that found nothing to do sleep until directories are queued or the walk is over.
+    // both are announced with the mutex held, so a worker about to sleep cannot miss them
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    uint64_t queuedBatches = 0;
+
+    const auto work = [&](size_t self) {
+        while (pending.load() > 0) {
+            uint64_t seenBatches;
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                seenBatches = queuedBatches;
+            }
+            DirTask task{nullptr, {}, 0};
+            {
+                std::lock_guard<std::mutex> lock(queues[self]->mutex);
+                if (!queues[self]->tasks.empty()) {
+                    task = std::move(queues[self]->tasks.back());
+                    queues[self]->tasks.pop_back();
+                }
+            }
+            for (size_t i = 1; !task.node && i < queues.size(); i++) {
+                auto& victim = *queues[(self + i) % queues.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = std::move(victim.tasks.front());
+                    victim.tasks.pop_front();
+                }
+            }
+            if (!task.node) {
+                std::unique_lock<std::mutex> lock(idleMutex);
+                idle.wait(lock, [&] { return pending.load() == 0 || queuedBatches != seenBatches; });
+                continue;
+            }
+
+            ReadDirectory(task.path, *task.node, options.readSizes);
+            auto& children = task.node->children;
+            if (!options.exclude.empty()) {
+                children.erase(std::remove_if(children.begin(), children.end(),
+                    [&](const DirNode& child) { return MatchAnyGlob(options.exclude, child.name); }), children.end());
+            }
+            // the children are final now, so pointers to them stay valid
+            std::vector<DirTask> subdirectories;
+            const bool descend = options.maxDepth == 0 || task.depth + 1 < options.maxDepth;
+            for (auto& child : children) {
+                if (child.isDirectory && descend) {
+                    subdirectories.push_back(DirTask{&child, JoinPath(task.path, child.name), task.depth + 1});
+                }
+            }
+            pending += subdirectories.size();
+            if (!subdirectories.empty()) {
+                {
+                    std::lock_guard<std::mutex> lock(queues[self]->mutex);
+                    for (auto& subdirectory : subdirectories) {
+                        queues[self]->tasks.push_back(std::move(subdirectory));
+                    }
+                }
+                {
+                    std::lock_guard<std::mutex> lock(idleMutex);
+                    queuedBatches++;
+                }
+                idle.notify_all();
+            }
+            if (--pending == 0) {
+                {
+                    std::lock_guard<std::mutex> lock(idleMutex);
+                }
+                idle.notify_all();
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < m_ThreadCount; i++) {
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return rootNode;
+}
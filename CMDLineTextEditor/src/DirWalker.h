@@ -0,0 +1,50 @@
+// DirWalker.h
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ThreadPool.h"
+
+struct DirNode {
+    std::string name;
+    bool isDirectory = false;
+    std::string error; // set when the directory could not be read
+    uint64_t size = 0; // bytes of a file, when the walk read sizes
+    std::vector<DirNode> children; // sorted by name
+};
+
+// what a walk leaves out. pruned directories are never read
+struct DirWalkOptions {
+    size_t maxDepth = 0; // levels of entries below the root, 0 for all
+    std::vector<std::string> exclude; // globs, matching entries are dropped with everything below them
+    bool readSizes = false;
+};
+
+// `*` any run of characters, `?` one character, `[a-z]` / `[!a-z]` one character of a set
+bool MatchGlob(std::string_view pattern, std::string_view name);
+bool MatchAnyGlob(const std::vector<std::string>& patterns, std::string_view name);
+
+// reads a directory tree on several threads. every worker pops directories from the back of
+// its own deque and steals from the front of the others' once it runs dry, so a deep subtree
+// found by one worker spreads to the idle ones, which sleep until more directories are queued.
+// entry types come from the directory read itself (d_type) where the platform offers them.
+// symbolic links are not followed: a link to a directory is shown as an entry without children,
+// unlike the recursive directory_iterator dir-tree used before, and a link cycle cannot trap the walk.
+// file sizes are read relative to the open directory, with statx where the kernel has it
+class DirWalker {
+public:
+    explicit DirWalker(size_t threadCount = ThreadPool::DefaultThreadCount());
+
+    // the root node is named after `root`, throws when it is not a readable directory
+    DirNode Walk(const std::string& root, const DirWalkOptions& options = {}) const;
+
+    // reads the entries of one directory into node.children, sorted by name, with empty subtrees
+    static void ReadDirectory(const std::string& path, DirNode& node, bool readSizes = false);
+    static std::string JoinPath(const std::string& parent, const std::string& name);
+
+private:
+    size_t m_ThreadCount;
+};
@@ -0,0 +1,93 @@
+#include "FileSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include <iterator>
+
+#include "MappedFile.h"
+
+namespace {
+
+void AddFiles(const std::string& path, const DirNode& node, std::vector<std::string>& files) {
+    for (const auto& child : node.children) {
+        auto childPath = DirWalker::JoinPath(path, child.name);
+        if (child.isDirectory) {
+            AddFiles(childPath, child, files);
+        } else {
+            files.push_back(std::move(childPath));
+        }
+    }
+}
+
+// how far into a file a NUL byte makes it binary
+constexpr size_t BinaryProbeSize = 8192;
+
+}
+
+std::vector<std::string> ListFiles(const std::string& root, const DirNode& tree) {
+    std::vector<std::string> files;
+    AddFiles(root, tree, files);
+    return files;
+}
+
+void SearchText(std::string_view text, const SubstringSearcher& searcher, size_t file, std::vector<FileHit>& hits) {
+    const auto length = searcher.GetNeedle().size();
+    if (length == 0)
+        return;
+    size_t line = 0, lineStart = 0, counted = 0;
+    for (auto at = searcher.Find(text); at != std::string_view::npos; at = searcher.Find(text, at + length)) {
+        for (const char* next; (next = static_cast<const char*>(std::memchr(text.data() + counted, '\n', at - counted)));) {
+            line++;
+            counted = lineStart = static_cast<size_t>(next - text.data()) + 1;
+        }
+        counted = at;
+        const auto lineEnd = std::min(text.find('\n', at), text.size());
+        hits.push_back(FileHit{file, line, at - lineStart, lineStart, lineEnd});
+    }
+}
+
+std::string_view GetHitLine(std::string_view text, const FileHit& hit) {
+    if (hit.lineBegin >= text.size())
+        return {};
+    return text.substr(hit.lineBegin, std::min(hit.lineEnd, text.size()) - hit.lineBegin);
+}
+
+FileSearchResult SearchFiles(std::vector<std::string> files, const SubstringSearcher& searcher, ThreadPool& pool) {
+    std::vector<std::vector<FileHit>> hitsByFile(files.size());
+    std::vector<char> binary(files.size(), 0), special(files.size(), 0);
+    std::atomic<size_t> next{0};
+    const size_t taskCount = std::min(pool.GetThreadCount(), files.size());
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(taskCount);
+    for (size_t t = 0; t < taskCount; t++) {
+        tasks.push_back(pool.Submit([&]() {
+            for (size_t i = next++; i < files.size(); i = next++) {
+                const MappedFile mapped(files[i], true);
+                if (!mapped.IsRegular()) {
+                    special[i] = 1;
+                    continue;
+                }
+                const auto text = mapped.GetView();
+                if (std::memchr(text.data(), '\0', std::min(text.size(), BinaryProbeSize))) {
+                    binary[i] = 1;
+                    continue;
+                }
+                SearchText(text, searcher, i, hitsByFile[i]);
+            }
+        }));
+    }
+    for (auto& task : tasks) {
+        task.get();
+    }
+
+    FileSearchResult result;
+    for (size_t i = 0; i < files.size(); i++) {
+        result.binaryFiles += binary[i];
+        result.specialFiles += special[i];
+        std::move(hitsByFile[i].begin(), hitsByFile[i].end(), std::back_inserter(result.hits));
+    }
+    result.files = std::move(files);
+    return result;
+}
@@ -0,0 +1,37 @@
+// FileSearch.h
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "DirWalker.h"
+#include "TextSearch.h"
+#include "ThreadPool.h"
+
+struct FileHit {
+    size_t file; // index into FileSearchResult::files
+    size_t line; // from 0, lines split like Editor reads them
+    size_t column; // byte offset in the line
+    size_t lineBegin, lineEnd; // byte offsets of the whole line in the file, read again to show it
+};
+
+struct FileSearchResult {
+    std::vector<std::string> files; // every file listed, in walk order
+    std::vector<FileHit> hits; // by file, then by position
+    size_t binaryFiles = 0; // files with a NUL byte near the start, left out like grep does
+    size_t specialFiles = 0; // pipes, sockets, devices and links to them, never read
+};
+
+// the paths of the files below `root`, in the order of the tree
+std::vector<std::string> ListFiles(const std::string& root, const DirNode& tree);
+
+// hits of the searcher in a whole text, as lines are counted by getline. the text is searched where it
+// is, not split into lines, so line breaks are only counted between hits
+void SearchText(std::string_view text, const SubstringSearcher& searcher, size_t file, std::vector<FileHit>& hits);
+
+// the line of a hit in the text it was found in, cut short when the file has shrunk since
+std::string_view GetHitLine(std::string_view text, const FileHit& hit);
+
+// maps every regular file and searches it on the pool, each worker taking the next file until none is left
+FileSearchResult SearchFiles(std::vector<std::string> files, const SubstringSearcher& searcher, ThreadPool& pool);
@@ -0,0 +1,181 @@
+#include "LineDiff.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+struct Point {
+    size_t x;
+    size_t y;
+};
+
+// x runs over the old lines, y over the new ones. a snake is one insertion or deletion followed, or
+// when found backwards preceded, by equal lines
+class MyersDiff {
+public:
+    MyersDiff(const std::vector<uint64_t>& a, const std::vector<uint64_t>& b, std::vector<DiffMatch>& matches)
+        : m_A(a), m_B(b), m_Matches(matches) {}
+
+    void Compare(size_t left, size_t top, size_t right, size_t bottom) {
+        size_t prefix = 0;
+        while (left + prefix < right && top + prefix < bottom && m_A[left + prefix] == m_B[top + prefix]) {
+            prefix++;
+        }
+        AddMatch(left, top, prefix);
+        left += prefix;
+        top += prefix;
+        size_t suffix = 0;
+        while (left < right - suffix && top < bottom - suffix && m_A[right - suffix - 1] == m_B[bottom - suffix - 1]) {
+            suffix++;
+        }
+        right -= suffix;
+        bottom -= suffix;
+        // only insertions or only deletions are left
+        if (left < right && top < bottom) {
+            Point start{}, finish{};
+            FindMiddleSnake(left, top, right, bottom, start, finish);
+            Compare(left, top, start.x, start.y);
+            Compare(start.x, start.y, finish.x, finish.y);
+            Compare(finish.x, finish.y, right, bottom);
+        }
+        AddMatch(right, bottom, suffix);
+    }
+
+private:
+    void AddMatch(size_t x, size_t y, size_t count) {
+        if (count == 0)
+            return;
+        if (!m_Matches.empty()) {
+            auto& last = m_Matches.back();
+            if (last.oldLine + last.count == x && last.newLine + last.count == y) {
+                last.count += count;
+                return;
+            }
+        }
+        m_Matches.push_back(DiffMatch{x, y, count});
+    }
+
+    // the furthest reaching paths by diagonal k = x - y, relative to the top left corner forwards and to
+    // the bottom right corner backwards, until they overlap
+    void FindMiddleSnake(size_t left, size_t top, size_t right, size_t bottom, Point& start, Point& finish) {
+        const auto width = static_cast<ptrdiff_t>(right - left), height = static_cast<ptrdiff_t>(bottom - top);
+        const ptrdiff_t delta = width - height;
+        const ptrdiff_t max = (width + height + 1) / 2;
+        // sized for the d reached rather than for the range, which may be all lines when only a few differ
+        ptrdiff_t offset = 0;
+        m_Forward.clear();
+        m_Backward.clear();
+        ptrdiff_t* forward = nullptr; // x reached on diagonal k
+        ptrdiff_t* backward = nullptr; // y reached on diagonal c = k - delta
+        for (ptrdiff_t d = 0; d <= max; d++) {
+            if (d + 1 >= offset) {
+                const auto grown = std::max<ptrdiff_t>(2 * offset, 16);
+                Grow(m_Forward, offset, grown);
+                Grow(m_Backward, offset, grown);
+                offset = grown;
+                forward = m_Forward.data() + offset;
+                backward = m_Backward.data() + offset;
+                if (d == 0) {
+                    forward[1] = static_cast<ptrdiff_t>(left);
+                    backward[1] = static_cast<ptrdiff_t>(bottom);
+                }
+            }
+            for (ptrdiff_t k = d; k >= -d; k -= 2) {
+                ptrdiff_t x, px;
+                if (k == -d || (k != d && forward[k - 1] < forward[k + 1])) {
+                    x = px = forward[k + 1];
+                } else {
+                    px = forward[k - 1];
+                    x = px + 1;
+                }
+                ptrdiff_t y = static_cast<ptrdiff_t>(top) + (x - static_cast<ptrdiff_t>(left)) - k;
+                const ptrdiff_t py = (d == 0 || x != px) ? y : y - 1;
+                while (x < static_cast<ptrdiff_t>(right) && y < static_cast<ptrdiff_t>(bottom) && m_A[x] == m_B[y]) {
+                    x++;
+                    y++;
+                }
+                forward[k] = x;
+                const ptrdiff_t c = k - delta;
+                if ((delta & 1) != 0 && c >= -(d - 1) && c <= d - 1 && y >= backward[c]) {
+                    start = Point{static_cast<size_t>(px), static_cast<size_t>(py)};
+                    finish = Point{static_cast<size_t>(x), static_cast<size_t>(y)};
+                    return;
+                }
+            }
+            for (ptrdiff_t c = d; c >= -d; c -= 2) {
+                ptrdiff_t y, py;
+                if (c == -d || (c != d && backward[c - 1] > backward[c + 1])) {
+                    y = py = backward[c + 1];
+                } else {
+                    py = backward[c - 1];
+                    y = py - 1;
+                }
+                const ptrdiff_t k = c + delta;
+                ptrdiff_t x = static_cast<ptrdiff_t>(left) + (y - static_cast<ptrdiff_t>(top)) + k;
+                const ptrdiff_t px = (d == 0 || y != py) ? x : x + 1;
+                while (x > static_cast<ptrdiff_t>(left) && y > static_cast<ptrdiff_t>(top) && m_A[x - 1] == m_B[y - 1]) {
+                    x--;
+                    y--;
+                }
+                backward[c] = y;
+                if ((delta & 1) == 0 && k >= -d && k <= d && x <= forward[k]) {
+                    start = Point{static_cast<size_t>(x), static_cast<size_t>(y)};
+                    finish = Point{static_cast<size_t>(px), static_cast<size_t>(py)};
+                    return;
+                }
+            }
+        }
+    }
+
+    // recenters the diagonals [-offset, offset] around a larger offset
+    static void Grow(std::vector<ptrdiff_t>& diagonals, ptrdiff_t offset, ptrdiff_t grown) {
+        std::vector<ptrdiff_t> larger(2 * grown + 1, 0);
+        std::copy(diagonals.begin(), diagonals.end(), larger.begin() + (grown - offset));
+        diagonals.swap(larger);
+    }
+
+private:
+    const std::vector<uint64_t>& m_A;
+    const std::vector<uint64_t>& m_B;
+    std::vector<DiffMatch>& m_Matches;
+    std::vector<ptrdiff_t> m_Forward;
+    std::vector<ptrdiff_t> m_Backward;
+};
+
+}
+
+uint64_t HashLine(std::string_view line) {
+    return std::hash<std::string_view>()(line);
+}
+
+TextLines TextLines::Split(std::string_view text) {
+    TextLines lines;
+    lines.textSize = text.size();
+    for (size_t begin = 0; begin < text.size();) {
+        const auto* newline = static_cast<const char*>(std::memchr(text.data() + begin, '\n', text.size() - begin));
+        const size_t end = newline ? static_cast<size_t>(newline - text.data()) : text.size();
+        lines.begins.push_back(begin);
+        lines.hashes.push_back(HashLine(text.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    return lines;
+}
+
+std::string_view TextLines::Get(std::string_view text, size_t line) const {
+    const auto begin = begins[line];
+    auto end = line + 1 < begins.size() ? begins[line + 1] - 1 : textSize;
+    // the last line, with its line break if it has one
+    if (line + 1 == begins.size() && end > begin && text[end - 1] == '\n') {
+        end--;
+    }
+    return text.substr(begin, end - begin);
+}
+
+std::vector<DiffMatch> DiffLines(const std::vector<uint64_t>& oldHashes, const std::vector<uint64_t>& newHashes) {
+    std::vector<DiffMatch> matches;
+    MyersDiff(oldHashes, newHashes, matches).Compare(0, 0, oldHashes.size(), newHashes.size());
+    return matches;
+}
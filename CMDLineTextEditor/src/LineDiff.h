@@ -0,0 +1,34 @@
+// LineDiff.h
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// a run of lines equal in both texts
+struct DiffMatch {
+    size_t oldLine;
+    size_t newLine;
+    size_t count;
+};
+
+// a line hash stands for the line when diffing, collisions are left to the 64 bits
+uint64_t HashLine(std::string_view line);
+
+// the lines of a text as getline splits them, kept as offsets so that a cached split outlives the text
+struct TextLines {
+    std::vector<size_t> begins;
+    std::vector<uint64_t> hashes;
+    size_t textSize = 0;
+
+    static TextLines Split(std::string_view text);
+    size_t Size() const { return begins.size(); }
+    std::string_view Get(std::string_view text, size_t line) const;
+};
+
+// the runs of equal lines of a longest common subsequence, in order, found by Myers' O((N+M)D) algorithm
+// in linear space: the middle snake of a range is searched from both ends at once and the ranges before
+// and after it are diffed the same way. common prefixes and suffixes are matched before any search, so
+// a few edits in a long text cost little more than comparing the hashes once
+std::vector<DiffMatch> DiffLines(const std::vector<uint64_t>& oldHashes, const std::vector<uint64_t>& newHashes);
@@ -0,0 +1,87 @@
+#include "MappedFile.h"
+
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path, bool regularOnly) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return;
+    m_Regular = GetFileType(file) == FILE_TYPE_DISK;
+    if (regularOnly && !m_Regular) {
+        CloseHandle(file);
+        return;
+    }
+    LARGE_INTEGER size;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            m_Mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (m_Mapping) {
+                m_File = file;
+                m_MappingHandle = mapping;
+                m_Data = static_cast<const char*>(m_Mapping);
+                m_Size = static_cast<size_t>(size.QuadPart);
+                return;
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    // a FIFO without a writer would block the open itself
+    const int fd = open(path.c_str(), regularOnly ? O_RDONLY | O_NONBLOCK : O_RDONLY);
+    if (fd < 0)
+        return;
+    struct stat st {};
+    const bool statted = fstat(fd, &st) == 0;
+    m_Regular = statted && S_ISREG(st.st_mode);
+    if (regularOnly && !m_Regular) {
+        close(fd);
+        return;
+    }
+    if (statted && st.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED) {
+            close(fd);
+            m_Mapping = mapping;
+            m_Data = static_cast<const char*>(mapping);
+            m_Size = static_cast<size_t>(st.st_size);
+            return;
+        }
+    }
+    close(fd);
+#endif
+    // empty files, pipes and file systems that cannot map
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return;
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    m_Buffer = buffer.str();
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+}
+
+MappedFile::~MappedFile() {
+    if (!m_Mapping)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_Mapping);
+    CloseHandle(m_MappingHandle);
+    CloseHandle(m_File);
+#else
+    munmap(m_Mapping, m_Size);
+#endif
+}
@@ -0,0 +1,32 @@
+// MappedFile.h
+
+#pragma once
+#include <string>
+#include <string_view>
+
+// read-only view of a whole file, mapped into memory where the platform allows it
+// and read into a buffer otherwise. a missing file gives an empty view
+class MappedFile {
+public:
+    // with `regularOnly`, anything but a regular file (a pipe, socket, device or a link to one)
+    // gives an empty view instead of being read until it ends, which it may never do
+    explicit MappedFile(const std::string& path, bool regularOnly = false);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    std::string_view GetView() const { return {m_Data, m_Size}; }
+    bool IsMapped() const { return m_Mapping != nullptr; }
+    bool IsRegular() const { return m_Regular; }
+
+private:
+    const char* m_Data = "";
+    size_t m_Size = 0;
+    void* m_Mapping = nullptr;
+    bool m_Regular = false;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_MappingHandle = nullptr;
+#endif
+    std::string m_Buffer; // fallback when mapping fails
+};
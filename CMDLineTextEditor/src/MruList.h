@@ -0,0 +1,132 @@
+// MruList.h
+
+#pragma once
+#include <cstddef>
+
+template<typename T>
+class MruList;
+
+// inherited by T, links an object into at most one MruList without any allocation
+template<typename T>
+class MruHook {
+public:
+    MruHook() = default;
+    MruHook(const MruHook&) = delete;
+    MruHook& operator=(const MruHook&) = delete;
+    ~MruHook() {
+        if (m_List) {
+            m_List->Unlink(this);
+        }
+    }
+
+    // moves the object to the front of its list, if it is in one
+    void Touch() {
+        if (m_List) {
+            m_List->MoveToFront(this);
+        }
+    }
+    bool IsLinked() const { return m_List != nullptr; }
+
+private:
+    friend class MruList<T>;
+    MruHook* m_Prev = nullptr;
+    MruHook* m_Next = nullptr;
+    MruList<T>* m_List = nullptr;
+};
+
+// intrusive most-recently-used list, the front is the most recently touched
+template<typename T>
+class MruList {
+public:
+    MruList() = default;
+    MruList(const MruList&) = delete;
+    MruList& operator=(const MruList&) = delete;
+    ~MruList() {
+        while (m_Head) {
+            Unlink(m_Head);
+        }
+    }
+
+    void PushFront(T* item) {
+        MruHook<T>* hook = item;
+        if (hook->m_List == this) {
+            MoveToFront(hook);
+            return;
+        }
+        if (hook->m_List) {
+            hook->m_List->Unlink(hook);
+        }
+        hook->m_List = this;
+        LinkFront(hook);
+        m_Size++;
+    }
+
+    void Remove(T* item) {
+        MruHook<T>* hook = item;
+        if (hook->m_List == this) {
+            Unlink(hook);
+        }
+    }
+
+    T* Front() const { return m_Head ? static_cast<T*>(m_Head) : nullptr; }
+    T* Back() const { return m_Tail ? static_cast<T*>(m_Tail) : nullptr; }
+    // the next less recently used item
+    T* Next(T* item) const {
+        MruHook<T>* hook = item;
+        return hook->m_Next ? static_cast<T*>(hook->m_Next) : nullptr;
+    }
+    // the next more recently used item
+    T* Prev(T* item) const {
+        MruHook<T>* hook = item;
+        return hook->m_Prev ? static_cast<T*>(hook->m_Prev) : nullptr;
+    }
+    size_t Size() const { return m_Size; }
+    bool Empty() const { return m_Size == 0; }
+
+private:
+    friend class MruHook<T>;
+
+    void LinkFront(MruHook<T>* hook) {
+        hook->m_Prev = nullptr;
+        hook->m_Next = m_Head;
+        if (m_Head) {
+            m_Head->m_Prev = hook;
+        }
+        m_Head = hook;
+        if (!m_Tail) {
+            m_Tail = hook;
+        }
+    }
+
+    void Detach(MruHook<T>* hook) {
+        if (hook->m_Prev) {
+            hook->m_Prev->m_Next = hook->m_Next;
+        } else {
+            m_Head = hook->m_Next;
+        }
+        if (hook->m_Next) {
+            hook->m_Next->m_Prev = hook->m_Prev;
+        } else {
+            m_Tail = hook->m_Prev;
+        }
+        hook->m_Prev = hook->m_Next = nullptr;
+    }
+
+    void MoveToFront(MruHook<T>* hook) {
+        if (m_Head == hook)
+            return;
+        Detach(hook);
+        LinkFront(hook);
+    }
+
+    void Unlink(MruHook<T>* hook) {
+        Detach(hook);
+        hook->m_List = nullptr;
+        m_Size--;
+    }
+
+private:
+    MruHook<T>* m_Head = nullptr;
+    MruHook<T>* m_Tail = nullptr;
+    size_t m_Size = 0;
+};
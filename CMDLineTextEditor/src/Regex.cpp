@@ -0,0 +1,796 @@
+#include "Regex.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t MaxNfaStates = 100000;
+constexpr int MaxRepeat = 1000;
+constexpr int MaxNesting = 1000; // groups and repeats, parsing and compiling recurse once per level
+constexpr size_t MaxDfaStates = 4096; // per DFA, before it starts over
+constexpr int Unbounded = -1;
+
+struct Node {
+    enum class Type { Bytes, Concat, Alternate, Repeat, Group, LineStart, LineEnd, Empty };
+    Type type = Type::Empty;
+    int byteSet = 0;
+    int group = 0; // of a Group
+    int min = 0, max = 0; // of a Repeat, max may be Unbounded
+    std::vector<Node> children;
+};
+
+std::bitset<256> ClassSet(char escape) {
+    std::bitset<256> set;
+    for (int c = 0; c < 256; c++) {
+        const bool digit = c >= '0' && c <= '9';
+        const bool word = digit || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+        const bool space = c == ' ' || (c >= '\t' && c <= '\r');
+        switch (escape) {
+        case 'd': case 'D': set[c] = digit; break;
+        case 'w': case 'W': set[c] = word; break;
+        case 's': case 'S': set[c] = space; break;
+        default: break;
+        }
+    }
+    return escape >= 'A' && escape <= 'Z' ? ~set : set;
+}
+
+} // namespace
+
+// recursive descent over the pattern, one method per precedence level
+class Regex::Parser {
+public:
+    Parser(const std::string& pattern, std::vector<std::bitset<256>>& byteSets)
+        : m_Pattern(pattern), m_ByteSets(byteSets) {}
+
+    Node Parse() {
+        auto node = ParseAlternation();
+        if (m_Position < m_Pattern.size())
+            Fail("unmatched )");
+        return node;
+    }
+    int GetGroupCount() const { return m_Groups; }
+
+private:
+    [[noreturn]] void Fail(const std::string& reason) const {
+        throw std::invalid_argument(reason + " at position " + std::to_string(m_Position + 1));
+    }
+    void Nest() {
+        if (++m_Depth > MaxNesting)
+            Fail("pattern nested too deeply");
+    }
+    bool AtEnd() const { return m_Position >= m_Pattern.size(); }
+    char Peek() const { return m_Pattern[m_Position]; }
+
+    Node Bytes(const std::bitset<256>& set) {
+        Node node;
+        node.type = Node::Type::Bytes;
+        node.byteSet = static_cast<int>(m_ByteSets.size());
+        m_ByteSets.push_back(set);
+        return node;
+    }
+
+    Node ParseAlternation() {
+        auto first = ParseConcatenation();
+        if (AtEnd() || Peek() != '|')
+            return first;
+        Node node;
+        node.type = Node::Type::Alternate;
+        node.children.push_back(std::move(first));
+        while (!AtEnd() && Peek() == '|') {
+            m_Position++;
+            node.children.push_back(ParseConcatenation());
+        }
+        return node;
+    }
+
+    Node ParseConcatenation() {
+        Node node;
+        node.type = Node::Type::Concat;
+        while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+            node.children.push_back(ParseRepetition());
+        }
+        if (node.children.size() == 1)
+            return std::move(node.children[0]);
+        return node;
+    }
+
+    Node ParseRepetition() {
+        auto node = ParseAtom();
+        const auto depth = m_Depth;
+        while (!AtEnd()) {
+            int min, max;
+            const auto c = Peek();
+            if (c == '*') {
+                min = 0, max = Unbounded;
+            } else if (c == '+') {
+                min = 1, max = Unbounded;
+            } else if (c == '?') {
+                min = 0, max = 1;
+            } else if (c != '{' || !ParseCount(min, max)) {
+                break;
+            }
+            if (c != '{') {
+                m_Position++;
+            }
+            if (node.type == Node::Type::LineStart || node.type == Node::Type::LineEnd)
+                Fail("nothing to repeat");
+            Nest();
+            Node repeat;
+            repeat.type = Node::Type::Repeat;
+            repeat.min = min;
+            repeat.max = max;
+            repeat.children.push_back(std::move(node));
+            node = std::move(repeat);
+        }
+        m_Depth = depth;
+        return node;
+    }
+
+    // `{m}`, `{m,}` or `{m,n}`, anything else is a literal `{`
+    bool ParseCount(int& min, int& max) {
+        size_t i = m_Position + 1;
+        const auto readNumber = [&](int& value) {
+            const auto begin = i;
+            value = 0;
+            while (i < m_Pattern.size() && m_Pattern[i] >= '0' && m_Pattern[i] <= '9' && i - begin < 5) {
+                value = value * 10 + (m_Pattern[i++] - '0');
+            }
+            return i > begin;
+        };
+        if (!readNumber(min))
+            return false;
+        max = min;
+        if (i < m_Pattern.size() && m_Pattern[i] == ',') {
+            i++;
+            if (!readNumber(max)) {
+                max = Unbounded;
+            }
+        }
+        if (i >= m_Pattern.size() || m_Pattern[i] != '}')
+            return false;
+        if (min > MaxRepeat || max > MaxRepeat || (max != Unbounded && max < min))
+            Fail("invalid repeat count");
+        m_Position = i + 1;
+        return true;
+    }
+
+    Node ParseAtom() {
+        const auto c = Peek();
+        switch (c) {
+        case '(': {
+            m_Position++;
+            Node group;
+            group.type = Node::Type::Group;
+            if (m_Pattern.compare(m_Position, 2, "?:") == 0) {
+                m_Position += 2;
+                group.group = -1;
+            } else {
+                group.group = m_Groups++;
+            }
+            Nest();
+            group.children.push_back(ParseAlternation());
+            m_Depth--;
+            if (AtEnd() || Peek() != ')')
+                Fail("missing )");
+            m_Position++;
+            if (group.group < 0)
+                return std::move(group.children[0]);
+            return group;
+        }
+        case '*': case '+': case '?':
+            Fail("nothing to repeat");
+        case '[':
+            return ParseSet();
+        case '.':
+            m_Position++;
+            return Bytes(std::bitset<256>().set());
+        case '^': case '$': {
+            m_Position++;
+            Node anchor;
+            anchor.type = c == '^' ? Node::Type::LineStart : Node::Type::LineEnd;
+            return anchor;
+        }
+        case '\\': {
+            std::bitset<256> set;
+            ParseEscape(set);
+            return Bytes(set);
+        }
+        default: {
+            m_Position++;
+            std::bitset<256> set;
+            set[static_cast<unsigned char>(c)] = true;
+            return Bytes(set);
+        }
+        }
+    }
+
+    // adds what the escape at the current position stands for to `set`, returns its byte when it is a single one
+    int ParseEscape(std::bitset<256>& set) {
+        m_Position++;
+        if (AtEnd())
+            Fail("trailing \\");
+        const auto c = m_Pattern[m_Position++];
+        switch (c) {
+        case 'd': case 'D': case 'w': case 'W': case 's': case 'S':
+            set |= ClassSet(c);
+            return -1;
+        case 't': set['\t'] = true; return '\t';
+        case 'n': set['\n'] = true; return '\n';
+        case 'r': set['\r'] = true; return '\r';
+        case 'f': set['\f'] = true; return '\f';
+        case 'v': set['\v'] = true; return '\v';
+        default:
+            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) {
+                m_Position--;
+                Fail(std::string("unsupported escape \\") + c);
+            }
+            set[static_cast<unsigned char>(c)] = true;
+            return static_cast<unsigned char>(c);
+        }
+    }
+
+    Node ParseSet() {
+        m_Position++;
+        const bool negated = !AtEnd() && Peek() == '^';
+        if (negated) {
+            m_Position++;
+        }
+        std::bitset<256> set;
+        for (bool first = true; !AtEnd() && (first || Peek() != ']'); first = false) {
+            int low;
+            if (Peek() == '\\') {
+                low = ParseEscape(set);
+                if (low < 0)
+                    continue;
+            } else {
+                low = static_cast<unsigned char>(m_Pattern[m_Position++]);
+            }
+            if (m_Position + 1 < m_Pattern.size() && Peek() == '-' && m_Pattern[m_Position + 1] != ']') {
+                m_Position++;
+                int high;
+                if (Peek() == '\\') {
+                    std::bitset<256> escaped;
+                    high = ParseEscape(escaped);
+                    if (high < 0)
+                        Fail("set as the end of a range");
+                } else {
+                    high = static_cast<unsigned char>(m_Pattern[m_Position++]);
+                }
+                if (high < low)
+                    Fail("reversed range");
+                for (int b = low; b <= high; b++) {
+                    set[b] = true;
+                }
+            } else {
+                set[low] = true;
+            }
+        }
+        if (AtEnd())
+            Fail("missing ]");
+        m_Position++;
+        return Bytes(negated ? ~set : set);
+    }
+
+private:
+    const std::string& m_Pattern;
+    std::vector<std::bitset<256>>& m_ByteSets;
+    size_t m_Position = 0;
+    int m_Groups = 1; // group 0 is the whole match
+    int m_Depth = 0; // of the groups and repeats being parsed
+};
+
+// a piece of NFA whose dangling exits are patched when the next piece is known
+struct Regex::Fragment {
+    int start;
+    std::vector<std::pair<int, bool>> exits; // state, and whether it is its second branch
+};
+
+size_t Regex::VectorHash::operator()(const std::vector<int>& states) const {
+    size_t hash = states.size();
+    for (const auto state : states) {
+        hash ^= static_cast<size_t>(state) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+Regex::Regex(const std::string& pattern)
+    : m_Pattern(pattern)
+{
+    Parser parser(m_Pattern, m_ByteSets);
+    const auto root = parser.Parse();
+    m_GroupCount = static_cast<size_t>(parser.GetGroupCount());
+
+    const auto patch = [this](const Fragment& fragment, int target) {
+        for (const auto& [state, second] : fragment.exits) {
+            (second ? m_Nfa[state].out1 : m_Nfa[state].out) = target;
+        }
+    };
+    const auto join = [](std::vector<std::pair<int, bool>> a, const std::vector<std::pair<int, bool>>& b) {
+        a.insert(a.end(), b.begin(), b.end());
+        return a;
+    };
+    // a Repeat compiles its child once per copy, so the recursion is over the tree, not the NFA
+    std::function<Fragment(const Node&)> compile = [&](const Node& node) -> Fragment {
+        if (m_Nfa.size() > MaxNfaStates)
+            throw std::invalid_argument("pattern too large");
+        switch (node.type) {
+        case Node::Type::Bytes: {
+            const auto state = AddState(NfaState::Kind::Bytes, -1, -1, node.byteSet);
+            return {state, {{state, false}}};
+        }
+        case Node::Type::LineStart:
+        case Node::Type::LineEnd:
+        case Node::Type::Empty: {
+            const auto kind = node.type == Node::Type::LineStart ? NfaState::Kind::LineStart
+                : node.type == Node::Type::LineEnd ? NfaState::Kind::LineEnd : NfaState::Kind::Jump;
+            const auto state = AddState(kind);
+            return {state, {{state, false}}};
+        }
+        case Node::Type::Group: {
+            const auto open = AddState(NfaState::Kind::Save, -1, -1, node.group * 2);
+            const auto body = compile(node.children[0]);
+            const auto close = AddState(NfaState::Kind::Save, -1, -1, node.group * 2 + 1);
+            m_Nfa[open].out = body.start;
+            patch(body, close);
+            return {open, {{close, false}}};
+        }
+        case Node::Type::Concat: {
+            if (node.children.empty())
+                return compile(Node());
+            auto whole = compile(node.children[0]);
+            for (size_t i = 1; i < node.children.size(); i++) {
+                auto next = compile(node.children[i]);
+                patch(whole, next.start);
+                whole.exits = std::move(next.exits);
+            }
+            return whole;
+        }
+        case Node::Type::Alternate: {
+            auto whole = compile(node.children[0]);
+            for (size_t i = 1; i < node.children.size(); i++) {
+                const auto next = compile(node.children[i]);
+                const auto split = AddState(NfaState::Kind::Split, whole.start, next.start);
+                whole = {split, join(std::move(whole.exits), next.exits)};
+            }
+            return whole;
+        }
+        case Node::Type::Repeat: {
+            const auto& child = node.children[0];
+            Fragment whole = compile(Node());
+            for (int i = 0; i < node.min; i++) {
+                const auto copy = compile(child);
+                patch(whole, copy.start);
+                whole.exits = copy.exits;
+            }
+            if (node.max == Unbounded) {
+                // the split tries the body first, which makes the repeat greedy for GetGroups
+                const auto body = compile(child);
+                const auto split = AddState(NfaState::Kind::Split, body.start);
+                patch(body, split);
+                patch(whole, split);
+                whole.exits = {{split, true}};
+            }
+            for (int i = node.min; node.max != Unbounded && i < node.max; i++) {
+                const auto body = compile(child);
+                const auto split = AddState(NfaState::Kind::Split, body.start);
+                patch(whole, split);
+                whole.exits = join(body.exits, {{split, true}});
+            }
+            return whole;
+        }
+        }
+        return compile(Node());
+    };
+
+    const auto open = AddState(NfaState::Kind::Save, -1, -1, 0);
+    const auto body = compile(root);
+    const auto close = AddState(NfaState::Kind::Save, -1, -1, 1);
+    const auto match = AddState(NfaState::Kind::Match);
+    m_Nfa[open].out = body.start;
+    patch(body, close);
+    m_Nfa[close].out = match;
+    m_Start = open;
+    m_Marks.assign(m_Nfa.size(), 0);
+
+    // bytes no set tells apart share a class, so DFA rows have one column per class
+    std::vector<int> classes(256, 0);
+    int classCount = 1;
+    for (const auto& set : m_ByteSets) {
+        std::unordered_map<int, int> split; // old class * 2 + in set -> new class
+        for (int b = 0; b < 256; b++) {
+            const auto key = classes[b] * 2 + (set[b] ? 1 : 0);
+            const auto it = split.emplace(key, static_cast<int>(split.size())).first;
+            classes[b] = it->second;
+        }
+        classCount = static_cast<int>(split.size());
+    }
+    m_ClassBytes.assign(classCount, 0);
+    for (int b = 255; b >= 0; b--) {
+        m_ByteClasses[b] = static_cast<uint8_t>(classes[b]);
+        m_ClassBytes[classes[b]] = static_cast<uint8_t>(b);
+    }
+
+    // what can start a match, for skipping the starts that cannot
+    std::vector<int> states, stack;
+    Closure(m_Start, true, states, m_Marks, NextMark(), stack);
+    for (const auto state : states) {
+        const auto& nfaState = m_Nfa[state];
+        if (nfaState.kind == NfaState::Kind::Bytes) {
+            m_FirstBytes |= m_ByteSets[nfaState.arg];
+        } else {
+            m_MatchesEmpty = true;
+        }
+    }
+    std::vector<int> atEmptyLine(states);
+    const auto mark = NextMark();
+    for (size_t i = 0; i < atEmptyLine.size(); i++) {
+        const auto& nfaState = m_Nfa[atEmptyLine[i]];
+        m_MatchesEmptyLine = m_MatchesEmptyLine || nfaState.kind == NfaState::Kind::Match;
+        if (nfaState.kind == NfaState::Kind::LineEnd) {
+            Closure(nfaState.out, true, atEmptyLine, m_Marks, mark, stack);
+        }
+    }
+    m_Unanchored.unanchored = true;
+}
+
+int Regex::AddState(NfaState::Kind kind, int out, int out1, int arg) {
+    NfaState state;
+    state.kind = kind;
+    state.out = out;
+    state.out1 = out1;
+    state.arg = arg;
+    m_Nfa.push_back(state);
+    return static_cast<int>(m_Nfa.size() - 1);
+}
+
+// the states reachable from `seed` without reading a byte, keeping those that read one, match or wait for the line end
+void Regex::Closure(int seed, bool atLineStart, std::vector<int>& states, std::vector<uint32_t>& marks,
+    uint32_t mark, std::vector<int>& stack) const
+{
+    stack.push_back(seed);
+    while (!stack.empty()) {
+        const auto index = stack.back();
+        stack.pop_back();
+        if (index < 0 || marks[index] == mark)
+            continue;
+        marks[index] = mark;
+        const auto& state = m_Nfa[index];
+        switch (state.kind) {
+        case NfaState::Kind::Bytes:
+        case NfaState::Kind::Match:
+        case NfaState::Kind::LineEnd:
+            states.push_back(index);
+            break;
+        case NfaState::Kind::Split:
+            stack.push_back(state.out1);
+            stack.push_back(state.out);
+            break;
+        case NfaState::Kind::LineStart:
+            if (atLineStart) {
+                stack.push_back(state.out);
+            }
+            break;
+        case NfaState::Kind::Jump:
+        case NfaState::Kind::Save:
+            stack.push_back(state.out);
+            break;
+        }
+    }
+}
+
+uint32_t Regex::NextMark() {
+    if (++m_Mark == 0) {
+        std::fill(m_Marks.begin(), m_Marks.end(), 0);
+        m_Mark = 1;
+    }
+    return m_Mark;
+}
+
+int Regex::Intern(LazyDfa& dfa, std::vector<int> states) {
+    std::sort(states.begin(), states.end());
+    if (const auto it = dfa.ids.find(states); it != dfa.ids.end())
+        return it->second;
+    uint8_t flags = states.empty() ? LazyDfa::Dead : 0;
+    // what the end of the line lets through, `$` holding there as often as it is passed
+    std::vector<int> atEnd(states), stack;
+    const auto mark = NextMark();
+    for (size_t i = 0; i < atEnd.size(); i++) {
+        const auto& nfaState = m_Nfa[atEnd[i]];
+        if (nfaState.kind == NfaState::Kind::Match) {
+            flags |= i < states.size() ? LazyDfa::Matching | LazyDfa::MatchingAtEnd : LazyDfa::MatchingAtEnd;
+        } else if (nfaState.kind == NfaState::Kind::LineEnd) {
+            Closure(nfaState.out, false, atEnd, m_Marks, mark, stack);
+        }
+    }
+    const auto id = static_cast<int>(dfa.sets.size());
+    dfa.ids.emplace(states, id);
+    dfa.sets.push_back(std::move(states));
+    dfa.flags.push_back(flags);
+    dfa.next.resize(dfa.next.size() + m_ClassBytes.size(), -1);
+    return id;
+}
+
+int Regex::Start(LazyDfa& dfa, bool atLineStart) {
+    auto& start = dfa.starts[atLineStart ? 1 : 0];
+    if (start < 0) {
+        std::vector<int> states, stack;
+        Closure(m_Start, atLineStart, states, m_Marks, NextMark(), stack);
+        start = Intern(dfa, std::move(states));
+    }
+    return start;
+}
+
+int Regex::Step(LazyDfa& dfa, int state, uint8_t byteClass) {
+    const auto byte = m_ClassBytes[byteClass];
+    std::vector<int> states, stack;
+    const auto mark = NextMark();
+    for (const auto index : dfa.sets[state]) {
+        const auto& nfaState = m_Nfa[index];
+        if (nfaState.kind == NfaState::Kind::Bytes && m_ByteSets[nfaState.arg][byte]) {
+            Closure(nfaState.out, false, states, m_Marks, mark, stack);
+        }
+    }
+    if (dfa.unanchored) {
+        Closure(m_Start, false, states, m_Marks, mark, stack);
+    }
+    if (dfa.sets.size() >= MaxDfaStates) {
+        // start over, the ids held by the caller go stale with it
+        dfa.sets.clear();
+        dfa.flags.clear();
+        dfa.next.clear();
+        dfa.ids.clear();
+        dfa.starts[0] = dfa.starts[1] = -1;
+        return Intern(dfa, std::move(states));
+    }
+    const auto next = Intern(dfa, std::move(states));
+    dfa.next[state * m_ClassBytes.size() + byteClass] = next;
+    return next;
+}
+
+bool Regex::EarliestEnd(std::string_view line, size_t from, size_t& end) {
+    auto& dfa = m_Unanchored;
+    const auto classCount = m_ClassBytes.size();
+    int state = Start(dfa, from == 0);
+    for (size_t i = from;; i++) {
+        const auto flags = dfa.flags[state];
+        if (flags & LazyDfa::Dead)
+            return false;
+        if (flags & LazyDfa::Matching) {
+            end = i;
+            return true;
+        }
+        if (i == line.size()) {
+            end = i;
+            return (flags & LazyDfa::MatchingAtEnd) != 0;
+        }
+        const auto byteClass = m_ByteClasses[static_cast<unsigned char>(line[i])];
+        const auto next = dfa.next[state * classCount + byteClass];
+        state = next >= 0 ? next : Step(dfa, state, byteClass);
+    }
+}
+
+bool Regex::LongestAt(std::string_view line, size_t begin, size_t& end) {
+    auto& dfa = m_Anchored;
+    const auto classCount = m_ClassBytes.size();
+    int state = Start(dfa, begin == 0);
+    bool found = false;
+    size_t i = begin;
+    for (;; i++) {
+        const auto flags = dfa.flags[state];
+        if (flags & LazyDfa::Matching) {
+            found = true;
+            end = i;
+        }
+        if ((flags & LazyDfa::Dead) || i == line.size())
+            break;
+        const auto byteClass = m_ByteClasses[static_cast<unsigned char>(line[i])];
+        const auto next = dfa.next[state * classCount + byteClass];
+        state = next >= 0 ? next : Step(dfa, state, byteClass);
+    }
+    if (i == line.size() && (dfa.flags[state] & LazyDfa::MatchingAtEnd)) {
+        found = true;
+        end = i;
+    }
+    return found;
+}
+
+bool Regex::Find(std::string_view line, size_t from, RegexMatch& match) {
+    if (from > line.size())
+        return false;
+    if (line.empty()) {
+        match = {0, 0};
+        return m_MatchesEmptyLine;
+    }
+    size_t earliestEnd = from;
+    if (!EarliestEnd(line, from, earliestEnd))
+        return false;
+    // a match ends at earliestEnd, so the leftmost one starts there at the latest
+    for (size_t begin = from; begin <= earliestEnd; begin++) {
+        if (!m_MatchesEmpty && (begin == line.size() || !m_FirstBytes[static_cast<unsigned char>(line[begin])]))
+            continue;
+        size_t end;
+        if (LongestAt(line, begin, end)) {
+            match = {begin, end};
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<RegexMatch> Regex::GetGroups(std::string_view line, const RegexMatch& match) const {
+    constexpr auto unset = std::string_view::npos;
+    std::vector<size_t> slots(m_GroupCount * 2, unset);
+    // depth first over (state, position), each pair at most once: whether it can reach the end of the
+    // match does not depend on the path taken to it, so a pair that failed once fails again
+    const size_t span = match.end - match.begin + 1;
+    std::vector<bool> visited(m_Nfa.size() * span, false);
+    struct Frame {
+        int state;
+        size_t position;
+        int branch = 0;
+        size_t saved = 0;
+    };
+    std::vector<Frame> frames{{m_Start, match.begin}};
+    bool matched = false;
+    while (!frames.empty() && !matched) {
+        auto& frame = frames.back();
+        const auto& state = m_Nfa[frame.state];
+        if (frame.branch == 0) {
+            const auto key = static_cast<size_t>(frame.state) * span + (frame.position - match.begin);
+            if (visited[key]) {
+                frames.pop_back();
+                continue;
+            }
+            visited[key] = true;
+        }
+        int next = -1;
+        size_t position = frame.position;
+        switch (state.kind) {
+        case NfaState::Kind::Match:
+            matched = frame.position == match.end;
+            break;
+        case NfaState::Kind::Bytes:
+            if (frame.branch == 0 && frame.position < match.end
+                && m_ByteSets[state.arg][static_cast<unsigned char>(line[frame.position])]) {
+                next = state.out;
+                position++;
+            }
+            break;
+        case NfaState::Kind::Split:
+            next = frame.branch == 0 ? state.out : frame.branch == 1 ? state.out1 : -1;
+            break;
+        case NfaState::Kind::Save:
+            if (frame.branch == 0) {
+                frame.saved = slots[state.arg];
+                slots[state.arg] = frame.position;
+                next = state.out;
+            } else {
+                slots[state.arg] = frame.saved;
+            }
+            break;
+        case NfaState::Kind::Jump:
+        case NfaState::Kind::LineStart:
+        case NfaState::Kind::LineEnd: {
+            const bool holds = state.kind == NfaState::Kind::Jump
+                || (state.kind == NfaState::Kind::LineStart ? frame.position == 0 : frame.position == line.size());
+            next = frame.branch == 0 && holds ? state.out : -1;
+            break;
+        }
+        }
+        if (matched)
+            break;
+        frame.branch++;
+        if (next >= 0) {
+            frames.push_back(Frame{next, position});
+        } else if (state.kind != NfaState::Kind::Split || frame.branch > 2) {
+            frames.pop_back();
+        }
+    }
+
+    std::vector<RegexMatch> groups(m_GroupCount, RegexMatch{unset, unset});
+    for (size_t group = 0; group < m_GroupCount; group++) {
+        if (slots[group * 2] != unset && slots[group * 2 + 1] != unset) {
+            groups[group] = {slots[group * 2], slots[group * 2 + 1]};
+        }
+    }
+    groups[0] = match;
+    return groups;
+}
+
+std::string Regex::Expand(const std::string& replacement, std::string_view line, const RegexMatch& match) const {
+    if (replacement.find('$') == std::string::npos)
+        return replacement;
+    std::vector<RegexMatch> groups;
+    std::string result;
+    for (size_t i = 0; i < replacement.size(); i++) {
+        const auto c = replacement[i];
+        if (c != '$' || i + 1 == replacement.size()) {
+            result += c;
+            continue;
+        }
+        const auto next = replacement[i + 1];
+        if (next == '$') {
+            result += '$';
+            i++;
+        } else if (next >= '0' && next <= '9') {
+            const auto group = static_cast<size_t>(next - '0');
+            i++;
+            if (group == 0) {
+                result += line.substr(match.begin, match.end - match.begin);
+                continue;
+            }
+            if (group >= m_GroupCount)
+                continue;
+            if (groups.empty()) {
+                groups = GetGroups(line, match);
+            }
+            if (groups[group].begin != std::string_view::npos) {
+                result += line.substr(groups[group].begin, groups[group].end - groups[group].begin);
+            }
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+RegexReplacement ReplaceRegexMatches(const std::vector<std::string>& lines, size_t first, size_t last, Regex& regex,
+    const std::string& replacement) {
+    RegexReplacement result;
+    for (size_t i = first; i <= last && i < lines.size(); i++) {
+        const std::string_view line = lines[i];
+        RegexMatch match;
+        if (!regex.Find(line, 0, match))
+            continue;
+        std::string text;
+        size_t copied = 0;
+        do {
+            text.append(line.substr(copied, match.begin - copied));
+            text += regex.Expand(replacement, line, match);
+            copied = match.end;
+            result.count++;
+        } while ((match.end > match.begin || match.end < line.size())
+            && regex.Find(line, match.end > match.begin ? match.end : match.end + 1, match));
+        text.append(line.substr(copied));
+        result.lines.emplace_back(i, std::move(text));
+    }
+    return result;
+}
+
+RegexCache::RegexCache(size_t capacity)
+    : m_Capacity(std::max<size_t>(capacity, 1))
+{
+}
+
+Ref<Regex> RegexCache::Get(const std::string& pattern) {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (const auto it = m_Entries.find(pattern); it != m_Entries.end()) {
+        it->second->Touch();
+        return it->second->regex;
+    }
+    auto entry = CreateScope<Entry>();
+    entry->pattern = pattern;
+    entry->regex = CreateRef<Regex>(pattern);
+    m_CompileCount++;
+    m_Recent.PushFront(entry.get());
+    const auto regex = entry->regex;
+    m_Entries.emplace(pattern, std::move(entry));
+    while (m_Entries.size() > m_Capacity) {
+        m_Entries.erase(m_Recent.Back()->pattern);
+    }
+    return regex;
+}
+
+size_t RegexCache::Size() const {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Entries.size();
+}
+
+RegexCache& RegexCache::Shared() {
+    static RegexCache cache;
+    return cache;
+}
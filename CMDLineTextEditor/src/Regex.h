@@ -0,0 +1,162 @@
+// Regex.h
+
+#pragma once
+#include <bitset>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Core.h"
+#include "MruList.h"
+#include "TextSearch.h"
+
+struct RegexMatch {
+    size_t begin = 0;
+    size_t end = 0; // one past the last byte
+};
+
+// patterns are compiled to an NFA that runs as a DFA built lazily, one state at a time as the
+// text asks for it. the DFA finds where the earliest match ends in one pass over the line, then
+// the leftmost start is looked for only up to there, so lines without a match cost one pass.
+//
+// syntax: literals, `.`, `[a-z]` and `[^...]` sets, `\d \w \s \D \W \S`, `\t \n \r` and escaped
+// punctuation, `(...)` groups, `(?:...)`, `|`, `* + ?`, `{m} {m,} {m,n}`, and `^ $` for the start
+// and end of the line. matches are leftmost-longest as in POSIX, not leftmost-first as in ECMAScript.
+//
+// the DFA is kept between calls, so a Regex is used by one thread at a time; copies are independent
+class Regex {
+public:
+    // throws std::invalid_argument for a malformed pattern
+    explicit Regex(const std::string& pattern);
+
+    // the leftmost-longest match starting at or after `from`, false when there is none
+    bool Find(std::string_view line, size_t from, RegexMatch& match);
+    // groups of a match found by Find, group 0 being the match itself. groups that took
+    // no part in the match are {npos, npos}
+    std::vector<RegexMatch> GetGroups(std::string_view line, const RegexMatch& match) const;
+    // `replacement` with `$0`-`$9` replaced by the groups of the match and `$$` by `$`
+    std::string Expand(const std::string& replacement, std::string_view line, const RegexMatch& match) const;
+
+    const std::string& GetPattern() const { return m_Pattern; }
+    size_t GetGroupCount() const { return m_GroupCount; }
+    // states built so far by both DFAs
+    size_t GetDfaStateCount() const { return m_Anchored.sets.size() + m_Unanchored.sets.size(); }
+
+private:
+    struct NfaState {
+        enum class Kind : uint8_t { Bytes, Split, Jump, Save, LineStart, LineEnd, Match };
+        Kind kind;
+        int out = -1;
+        int out1 = -1; // second branch of a Split
+        int arg = 0; // byte set of Bytes, slot of Save
+    };
+
+    struct VectorHash {
+        size_t operator()(const std::vector<int>& states) const;
+    };
+
+    // states are sets of NFA states, transitions are by byte class and filled in on first use.
+    // when it grows past its limit it starts over from the state it is in
+    struct LazyDfa {
+        static constexpr uint8_t Matching = 1; // holds the Match state
+        static constexpr uint8_t MatchingAtEnd = 2; // matches when the line ends here
+        static constexpr uint8_t Dead = 4; // no match can follow
+
+        bool unanchored = false; // a match may start at every position
+        std::vector<std::vector<int>> sets;
+        std::vector<uint8_t> flags;
+        std::vector<int> next; // sets.size() * class count, -1 while unknown
+        std::unordered_map<std::vector<int>, int, VectorHash> ids;
+        int starts[2] = {-1, -1}; // by whether the line starts at that position
+    };
+
+    class Parser;
+    struct Fragment;
+
+    int AddState(NfaState::Kind kind, int out = -1, int out1 = -1, int arg = 0);
+    uint32_t NextMark();
+    void Closure(int seed, bool atLineStart, std::vector<int>& states, std::vector<uint32_t>& marks,
+        uint32_t mark, std::vector<int>& stack) const;
+    int Intern(LazyDfa& dfa, std::vector<int> states);
+    int Start(LazyDfa& dfa, bool atLineStart);
+    int Step(LazyDfa& dfa, int state, uint8_t byteClass);
+    bool EarliestEnd(std::string_view line, size_t from, size_t& end);
+    bool LongestAt(std::string_view line, size_t begin, size_t& end);
+
+private:
+    std::string m_Pattern;
+    std::vector<NfaState> m_Nfa;
+    std::vector<std::bitset<256>> m_ByteSets;
+    int m_Start = -1;
+    size_t m_GroupCount = 1;
+    uint8_t m_ByteClasses[256] = {};
+    std::vector<uint8_t> m_ClassBytes; // one byte of every class
+    std::bitset<256> m_FirstBytes; // bytes a non-empty match can start with
+    bool m_MatchesEmpty = false;
+    // an empty line is where `^` and `$` both hold, which the DFA states, kept apart from positions, do not see
+    bool m_MatchesEmptyLine = false;
+    mutable std::vector<uint32_t> m_Marks;
+    uint32_t m_Mark = 0;
+    LazyDfa m_Anchored;
+    LazyDfa m_Unanchored;
+};
+
+// the lines that replacing every match changes, computed without changing them
+struct RegexReplacement {
+    std::vector<std::pair<size_t, std::string>> lines; // index and new text, by index
+    size_t count = 0; // matches replaced
+};
+
+// replaces the matches in lines `first` to `last` like ForEachRegexHit finds them, with
+// `replacement` expanded by Regex::Expand
+RegexReplacement ReplaceRegexMatches(const std::vector<std::string>& lines, size_t first, size_t last, Regex& regex,
+    const std::string& replacement);
+
+// compiled patterns by pattern text, so that scripts running the same pattern again do not
+// compile it again. the least recently used pattern is dropped past the capacity
+class RegexCache {
+public:
+    explicit RegexCache(size_t capacity = 64);
+    RegexCache(const RegexCache&) = delete;
+    RegexCache& operator=(const RegexCache&) = delete;
+
+    // compiles on a miss, throws like Regex
+    Ref<Regex> Get(const std::string& pattern);
+    size_t Size() const;
+    size_t GetCompileCount() const { return m_CompileCount; }
+
+    // the cache the editors share
+    static RegexCache& Shared();
+
+private:
+    struct Entry : MruHook<Entry> {
+        std::string pattern;
+        Ref<Regex> regex;
+    };
+
+    size_t m_Capacity;
+    size_t m_CompileCount = 0;
+    mutable std::mutex m_Mutex;
+    MruList<Entry> m_Recent; // before the entries, which unlink themselves when destroyed
+    std::unordered_map<std::string, Scope<Entry>> m_Entries;
+};
+
+// like ForEachHit, for the matches of a regex. after an empty match the search goes on one byte further
+template<typename F>
+size_t ForEachRegexHit(const std::vector<std::string>& lines, size_t first, size_t last, Regex& regex, F&& onHit) {
+    size_t hits = 0;
+    for (size_t line = first; line <= last && line < lines.size(); line++) {
+        const std::string_view text = lines[line];
+        RegexMatch match;
+        for (size_t from = 0; from <= text.size() && regex.Find(text, from, match);
+            from = match.end > match.begin ? match.end : match.end + 1) {
+            hits++;
+            if (!onHit(TextHit{line, match.begin, match.end - match.begin}))
+                return hits;
+        }
+    }
+    return hits;
+}
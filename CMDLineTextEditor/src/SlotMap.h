@@ -0,0 +1,129 @@
+// SlotMap.h
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// values stored densely and addressed through stable handles.
+// a handle packs the slot in its low 32 bits and the generation of the slot above,
+// so the handle of an erased value never matches the value that reuses the slot.
+template<typename T>
+class SlotMap {
+public:
+    using Handle = int64_t;
+    static constexpr Handle InvalidHandle = -1;
+
+    Handle Insert(T value) {
+        uint32_t slot;
+        if (m_FreeSlots.empty()) {
+            slot = static_cast<uint32_t>(m_Slots.size());
+            m_Slots.push_back(Slot{0, 0});
+        } else {
+            slot = m_FreeSlots.back();
+            m_FreeSlots.pop_back();
+        }
+        m_Slots[slot].denseIndex = static_cast<uint32_t>(m_Values.size());
+        m_Values.push_back(std::move(value));
+        m_SlotOfValue.push_back(slot);
+        m_SequenceOfValue.push_back(m_NextSequence++);
+        return MakeHandle(slot, m_Slots[slot].generation);
+    }
+
+    // moves the last value into the hole, so the dense order is not kept
+    bool Erase(Handle handle) {
+        if (!Contains(handle))
+            return false;
+        const auto slot = SlotOf(handle);
+        const auto dense = m_Slots[slot].denseIndex;
+        const auto last = static_cast<uint32_t>(m_Values.size() - 1);
+        if (dense != last) {
+            m_Values[dense] = std::move(m_Values[last]);
+            m_SlotOfValue[dense] = m_SlotOfValue[last];
+            m_SequenceOfValue[dense] = m_SequenceOfValue[last];
+            m_Slots[m_SlotOfValue[dense]].denseIndex = dense;
+        }
+        m_Values.pop_back();
+        m_SlotOfValue.pop_back();
+        m_SequenceOfValue.pop_back();
+        m_Slots[slot].generation = (m_Slots[slot].generation + 1) & 0x7fffffffu;
+        m_FreeSlots.push_back(slot);
+        return true;
+    }
+
+    bool Contains(Handle handle) const {
+        if (handle < 0)
+            return false;
+        const auto slot = SlotOf(handle);
+        return slot < m_Slots.size() && m_Slots[slot].generation == GenerationOf(handle)
+            && m_Slots[slot].denseIndex < m_Values.size() && m_SlotOfValue[m_Slots[slot].denseIndex] == slot;
+    }
+
+    T* Get(Handle handle) {
+        return Contains(handle) ? &m_Values[m_Slots[SlotOf(handle)].denseIndex] : nullptr;
+    }
+    const T* Get(Handle handle) const {
+        return Contains(handle) ? &m_Values[m_Slots[SlotOf(handle)].denseIndex] : nullptr;
+    }
+
+    // handle of the value at a position of the dense storage
+    Handle GetHandleAt(size_t denseIndex) const {
+        const auto slot = m_SlotOfValue[denseIndex];
+        return MakeHandle(slot, m_Slots[slot].generation);
+    }
+
+    // every handle in the order the values were inserted, sorted on each call
+    std::vector<Handle> GetHandlesInInsertionOrder() const {
+        std::vector<uint32_t> order(m_Values.size());
+        for (uint32_t i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(),
+            [this](uint32_t a, uint32_t b) { return m_SequenceOfValue[a] < m_SequenceOfValue[b]; });
+        std::vector<Handle> handles;
+        handles.reserve(order.size());
+        for (const auto dense : order) {
+            handles.push_back(GetHandleAt(dense));
+        }
+        return handles;
+    }
+
+    void Clear() {
+        for (const auto slot : m_SlotOfValue) {
+            m_Slots[slot].generation = (m_Slots[slot].generation + 1) & 0x7fffffffu;
+            m_FreeSlots.push_back(slot);
+        }
+        m_Values.clear();
+        m_SlotOfValue.clear();
+        m_SequenceOfValue.clear();
+    }
+
+    size_t Size() const { return m_Values.size(); }
+    bool Empty() const { return m_Values.empty(); }
+
+    typename std::vector<T>::iterator begin() { return m_Values.begin(); }
+    typename std::vector<T>::iterator end() { return m_Values.end(); }
+    typename std::vector<T>::const_iterator begin() const { return m_Values.begin(); }
+    typename std::vector<T>::const_iterator end() const { return m_Values.end(); }
+
+private:
+    struct Slot {
+        uint32_t denseIndex;
+        uint32_t generation;
+    };
+
+    static Handle MakeHandle(uint32_t slot, uint32_t generation) {
+        // generations wrap at 31 bits, so every valid handle is non-negative
+        return static_cast<Handle>((static_cast<uint64_t>(generation) << 32) | slot);
+    }
+    static uint32_t SlotOf(Handle handle) { return static_cast<uint32_t>(handle & 0xffffffff); }
+    static uint32_t GenerationOf(Handle handle) { return static_cast<uint32_t>(handle >> 32); }
+
+private:
+    std::vector<Slot> m_Slots;
+    std::vector<uint32_t> m_FreeSlots;
+    std::vector<T> m_Values;
+    std::vector<uint32_t> m_SlotOfValue; // dense index -> slot
+    std::vector<uint64_t> m_SequenceOfValue; // dense index -> insertion sequence
+    uint64_t m_NextSequence = 0;
+};
@@ -0,0 +1,117 @@
+#include "TextSearch.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXT_SEARCH_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+// how common a byte is in source code and prose, higher is more common. the two rarest bytes
+// of a needle are the ones tested first, which keeps false candidates out of the full compare
+int ByteFrequency(unsigned char c) {
+    static const char* common = " etaoinsrlcdhu\nmpfgy_,.(bw);=v\"kx-0:1*'/2>{}<[]j3q#z4&59678!+|%\\?~^@$`";
+    const char* found = c == '\0' ? nullptr : std::strchr(common, c);
+    if (found)
+        return 255 - static_cast<int>(found - common);
+    return c >= 'A' && c <= 'Z' ? 160 : 0;
+}
+
+#ifdef TEXT_SEARCH_SSE2
+unsigned CountTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
+
+} // namespace
+
+SubstringSearcher::SubstringSearcher(std::string needle)
+    : m_Needle(std::move(needle))
+{
+    // the rarest byte, then the rarest other one
+    for (size_t i = 1; i < m_Needle.size(); i++) {
+        if (ByteFrequency(m_Needle[i]) < ByteFrequency(m_Needle[m_RareOffsets[0]])) {
+            m_RareOffsets[0] = i;
+        }
+    }
+    m_RareOffsets[1] = m_RareOffsets[0] == 0 ? 1 : 0;
+    for (size_t i = 0; i < m_Needle.size(); i++) {
+        if (i != m_RareOffsets[0] && ByteFrequency(m_Needle[i]) < ByteFrequency(m_Needle[m_RareOffsets[1]])) {
+            m_RareOffsets[1] = i;
+        }
+    }
+}
+
+size_t SubstringSearcher::Find(std::string_view haystack, size_t from) const {
+    const size_t length = m_Needle.size();
+    if (from > haystack.size() || length > haystack.size() - from)
+        return std::string_view::npos;
+    if (length == 0)
+        return from;
+    const char* text = haystack.data();
+    const char* needle = m_Needle.data();
+    if (length == 1) {
+        const void* found = std::memchr(text + from, needle[0], haystack.size() - from);
+        return found ? static_cast<const char*>(found) - text : std::string_view::npos;
+    }
+    // a match starts before `end`
+    const size_t end = haystack.size() - length + 1;
+    const size_t rare0 = m_RareOffsets[0], rare1 = m_RareOffsets[1];
+    size_t i = from;
+#ifdef TEXT_SEARCH_SSE2
+    if (end - from >= 16) {
+        const __m128i byte0 = _mm_set1_epi8(needle[rare0]);
+        const __m128i byte1 = _mm_set1_epi8(needle[rare1]);
+        const auto candidates = [&](size_t at) {
+            const __m128i block0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + at + rare0));
+            const __m128i block1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + at + rare1));
+            return static_cast<unsigned>(_mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(byte0, block0), _mm_cmpeq_epi8(byte1, block1))));
+        };
+        const auto verify = [&](size_t at, unsigned mask) {
+            for (; mask != 0; mask &= mask - 1) {
+                const auto candidate = at + CountTrailingZeros(mask);
+                if (std::memcmp(text + candidate, needle, length) == 0)
+                    return candidate;
+            }
+            return std::string_view::npos;
+        };
+        // both loads stay inside the haystack while at + 16 <= end
+        for (; i + 16 <= end; i += 16) {
+            if (const auto mask = candidates(i); mask != 0) {
+                if (const auto found = verify(i, mask); found != std::string_view::npos)
+                    return found;
+            }
+        }
+        // the last block overlaps the one before, the starts already tested are masked out
+        if (i < end) {
+            const size_t last = end - 16;
+            const auto mask = candidates(last) & (0xffffu << (i - last));
+            return verify(last, mask);
+        }
+        return std::string_view::npos;
+    }
+#endif
+    // short haystacks, and everything on targets without SSE2
+    while (i < end) {
+        const void* found = std::memchr(text + i + rare0, needle[rare0], end - i);
+        if (!found)
+            return std::string_view::npos;
+        i = static_cast<const char*>(found) - text - rare0;
+        if (text[i + rare1] == needle[rare1] && std::memcmp(text + i, needle, length) == 0)
+            return i;
+        i++;
+    }
+    return std::string_view::npos;
+}
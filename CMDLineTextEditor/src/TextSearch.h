@@ -0,0 +1,52 @@
+// TextSearch.h
+
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct TextHit {
+    size_t line; // from 0
+    size_t column; // byte offset in the line
+    size_t length; // bytes matched
+};
+
+// looks for one needle in many haystacks. candidates are the positions where the two rarest bytes
+// of the needle, by the usual byte frequencies of text, both match. they are tested 16 positions at a
+// time with SSE2 where the target has it and only candidates are compared in full, so text that
+// rarely holds both bytes is skipped at memory speed
+class SubstringSearcher {
+public:
+    explicit SubstringSearcher(std::string needle);
+
+    // the first match starting at or after `from`, npos when there is none.
+    // an empty needle matches at `from`
+    size_t Find(std::string_view haystack, size_t from = 0) const;
+    const std::string& GetNeedle() const { return m_Needle; }
+
+private:
+    std::string m_Needle;
+    size_t m_RareOffsets[2] = {0, 0}; // distinct when the needle has two bytes or more
+};
+
+// calls `onHit(const TextHit&)` for the matches in lines [first, last], in order and not overlapping
+// within a line, until it returns false. lines are searched where they are, nothing is copied.
+// returns the number of hits passed to `onHit`, none for an empty needle
+template<typename F>
+size_t ForEachHit(const std::vector<std::string>& lines, size_t first, size_t last,
+    const SubstringSearcher& searcher, F&& onHit)
+{
+    const auto length = searcher.GetNeedle().size();
+    if (length == 0)
+        return 0;
+    size_t hits = 0;
+    for (size_t line = first; line <= last && line < lines.size(); line++) {
+        const std::string_view text = lines[line];
+        for (auto column = searcher.Find(text); column != std::string_view::npos; column = searcher.Find(text, column + length)) {
+            hits++;
+            if (!onHit(TextHit{line, column, length}))
+                return hits;
+        }
+    }
+    return hits;
+}
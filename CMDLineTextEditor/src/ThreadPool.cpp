@@ -0,0 +1,43 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    m_Threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        m_Threads.emplace_back(&ThreadPool::Run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stopping = true;
+    }
+    m_WakeWorker.notify_all();
+    for (auto& thread : m_Threads) {
+        thread.join();
+    }
+}
+
+size_t ThreadPool::DefaultThreadCount() {
+    // hardware_concurrency may report 0 when it is unknown
+    const auto hardware = std::thread::hardware_concurrency();
+    return std::clamp<size_t>(hardware, 2, 16);
+}
+
+void ThreadPool::Run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeWorker.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Tasks.empty())
+                return;
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,49 @@
+// ThreadPool.h
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fixed number of worker threads taking tasks from one queue in submission order
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = DefaultThreadCount());
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    // runs the tasks already submitted, then joins the workers
+    ~ThreadPool();
+
+    // exceptions thrown by the task are rethrown from the future
+    template<typename F>
+    auto Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        auto future = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Tasks.emplace_back([packaged]() { (*packaged)(); });
+        }
+        m_WakeWorker.notify_one();
+        return future;
+    }
+
+    size_t GetThreadCount() const { return m_Threads.size(); }
+    static size_t DefaultThreadCount();
+
+private:
+    void Run();
+
+private:
+    std::vector<std::thread> m_Threads;
+    std::deque<std::function<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeWorker;
+    bool m_Stopping = false;
+};
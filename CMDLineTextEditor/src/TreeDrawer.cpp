@@ -1,26 +1,187 @@
 #include "TreeDrawer.h"
+#include <algorithm>
+#include <cstdio>
 #include <filesystem>
+#include <functional>
+#include <queue>
+#include <unordered_map>
 
 #include "Outputer.h"
 
-void DrawDirTree(const std::string& dirpath, const std::string& prefix) {
-    try {
-        std::vector<std::filesystem::directory_entry> entries;
-        for (const auto& entry : std::filesystem::directory_iterator(dirpath)) {
-            entries.push_back(entry);
-        }
-        for (int x = 0; x < entries.size(); ++x) {
-            auto& entry = entries[x];
-            Outputer::Out() << prefix;
-            auto dirStr = entry.path().string();
-            auto pref = x == entries.size()-1 ? "└── " : "├── " ;
-            Outputer::Out() << pref << dirStr.substr(dirStr.find_last_of("\\/") + 1) << std::endl;
-
-            if (std::filesystem::is_directory(entry)) {
-                DrawDirTree(dirStr, x == entries.size()-1 ? prefix + "    " : prefix + "│   ");
+namespace {
+
+bool IsDrawn(const DirNode& entry, const DirTreeOptions& options) {
+    if (MatchAnyGlob(options.walk.exclude, entry.name))
+        return false;
+    return entry.isDirectory || options.include.empty() || MatchAnyGlob(options.include, entry.name);
+}
+
+// index of the first drawn child at or after `from`
+size_t NextDrawn(const DirNode& node, size_t from, const DirTreeOptions& options) {
+    while (from < node.children.size() && !IsDrawn(node.children[from], options)) {
+        from++;
+    }
+    return from;
+}
+
+struct DirTotals {
+    uint64_t bytes = 0;
+    size_t files = 0;
+};
+
+struct DirSummary {
+    std::unordered_map<const DirNode*, DirTotals> totals; // every directory, the root included
+    std::vector<std::pair<uint64_t, std::string>> largest; // size and path below the root, largest first
+};
+
+// one pass over the whole tree, whatever the depth drawn, so that the totals of a directory cover everything below it
+DirSummary Summarize(const DirNode& root, const DirTreeOptions& options) {
+    struct Frame {
+        const DirNode* node;
+        size_t next;
+        std::string path;
+    };
+    DirSummary summary;
+    using SizedPath = std::pair<uint64_t, std::string>;
+    std::priority_queue<SizedPath, std::vector<SizedPath>, std::greater<>> largest;
+    std::vector<Frame> frames{{&root, 0, {}}};
+    while (!frames.empty()) {
+        auto& frame = frames.back();
+        if (frame.next >= frame.node->children.size()) {
+            const auto totals = summary.totals[frame.node];
+            frames.pop_back();
+            if (!frames.empty()) {
+                auto& parent = summary.totals[frames.back().node];
+                parent.bytes += totals.bytes;
+                parent.files += totals.files;
             }
+            continue;
+        }
+        const auto& entry = frame.node->children[frame.next++];
+        if (!IsDrawn(entry, options))
+            continue;
+        const auto path = frame.path.empty() ? entry.name : frame.path + '/' + entry.name;
+        if (entry.isDirectory) {
+            frames.push_back(Frame{&entry, 0, path});
+            continue;
         }
-    } catch (const std::filesystem::filesystem_error& e) {
+        auto& totals = summary.totals[frame.node];
+        totals.bytes += entry.size;
+        totals.files++;
+        if (options.largestFiles == 0)
+            continue;
+        if (largest.size() < options.largestFiles) {
+            largest.emplace(entry.size, path);
+        } else if (entry.size > largest.top().first) {
+            largest.pop();
+            largest.emplace(entry.size, path);
+        }
+    }
+    for (; !largest.empty(); largest.pop()) {
+        summary.largest.push_back(largest.top());
+    }
+    std::reverse(summary.largest.begin(), summary.largest.end());
+    return summary;
+}
+
+std::string FormatBytes(uint64_t bytes) {
+    if (bytes < 1024)
+        return std::to_string(bytes) + " B";
+    const char* units[] = {"KiB", "MiB", "GiB", "TiB"};
+    double value = static_cast<double>(bytes) / 1024;
+    size_t unit = 0;
+    while (value >= 1024 && unit + 1 < std::size(units)) {
+        value /= 1024;
+        unit++;
+    }
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.1f %s", value, units[unit]);
+    return text;
+}
+
+std::string FormatTotals(const DirTotals& totals) {
+    return std::to_string(totals.files) + (totals.files == 1 ? " file, " : " files, ") + FormatBytes(totals.bytes);
+}
+
+} // namespace
+
+void DrawDirTree(const std::string& dirpath, const DirTreeOptions& options) {
+    try {
+        DrawDirTree(DirWalker().Walk(dirpath, options.walk), options);
+    } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
     }
 }
+
+void DrawDirTree(const DirNode& node, const DirTreeOptions& options) {
+    struct Frame {
+        const DirNode* node;
+        size_t next; // the next child to draw
+    };
+    constexpr size_t flushSize = 64 * 1024;
+    std::string out;
+    out.reserve(flushSize + 1024);
+    const auto summary = options.summary ? Summarize(node, options) : DirSummary{};
+    std::vector<Frame> frames{{&node, NextDrawn(node, 0, options)}};
+    // for every open directory but the root, whether it was the last entry of its parent
+    std::vector<bool> lastEntries;
+    size_t drawn = 0;
+    if (!node.error.empty()) {
+        std::cerr << "Error: " << node.error << std::endl;
+    }
+    while (!frames.empty()) {
+        auto& frame = frames.back();
+        if (frame.next >= frame.node->children.size()) {
+            frames.pop_back();
+            if (!lastEntries.empty()) {
+                lastEntries.pop_back();
+            }
+            continue;
+        }
+        if (options.maxEntries != 0 && drawn == options.maxEntries) {
+            out += "... stopped after " + std::to_string(drawn) + " entries\n";
+            break;
+        }
+        const auto& entry = frame.node->children[frame.next];
+        frame.next = NextDrawn(*frame.node, frame.next + 1, options);
+        const bool last = frame.next >= frame.node->children.size();
+        for (const bool ancestorLast : lastEntries) {
+            out += ancestorLast ? "    " : "│   ";
+        }
+        out += last ? "└── " : "├── ";
+        out += entry.name;
+        if (options.summary) {
+            out += "  (";
+            out += entry.isDirectory ? FormatTotals(summary.totals.at(&entry)) : FormatBytes(entry.size);
+            out += ')';
+        }
+        out += '\n';
+        drawn++;
+        if (out.size() >= flushSize) {
+            Outputer::Out() << out;
+            out.clear();
+        }
+
+        const size_t depth = frames.size();
+        if (entry.isDirectory && (options.walk.maxDepth == 0 || depth < options.walk.maxDepth)) {
+            if (!entry.error.empty()) {
+                // in order with the entries drawn so far
+                Outputer::Out() << out << std::flush;
+                out.clear();
+                std::cerr << "Error: " << entry.error << std::endl;
+            }
+            lastEntries.push_back(last);
+            frames.push_back(Frame{&entry, NextDrawn(entry, 0, options)});
+        }
+    }
+    if (options.summary) {
+        out += "Total: " + FormatTotals(summary.totals.at(&node)) + '\n';
+        if (!summary.largest.empty()) {
+            out += "Largest files:\n";
+        }
+        for (const auto& [size, path] : summary.largest) {
+            out += "    " + FormatBytes(size) + "  " + path + '\n';
+        }
+    }
+    Outputer::Out() << out << std::flush;
+}
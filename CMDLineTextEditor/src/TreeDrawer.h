@@ -1,5 +1,19 @@
 #pragma once
 #include <string>
+#include <vector>
 
+#include "DirWalker.h"
 
-void DrawDirTree(const std::string& dirpath, const std::string& prefix);
+struct DirTreeOptions {
+    DirWalkOptions walk; // also applied when drawing an already walked tree
+    size_t maxEntries = 0; // entries drawn before the output stops, 0 for all
+    std::vector<std::string> include; // globs, when set only the files matching one of them are drawn
+    // sizes and file counts next to every entry, then the largest files. needs a tree walked with sizes
+    bool summary = false;
+    size_t largestFiles = 10;
+};
+
+// walks `dirpath` with a DirWalker and draws it, entries sorted by name
+void DrawDirTree(const std::string& dirpath, const DirTreeOptions& options = {});
+// draws without recursion, so the depth of the tree is not bounded by the stack
+void DrawDirTree(const DirNode& node, const DirTreeOptions& options = {});
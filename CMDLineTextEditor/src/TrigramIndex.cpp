@@ -0,0 +1,109 @@
+#include "TrigramIndex.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+void AddTrigrams(std::string_view text, std::vector<uint32_t>& trigrams) {
+    trigrams.clear();
+    if (text.size() < 3)
+        return;
+    trigrams.reserve(text.size() - 2);
+    uint32_t trigram = static_cast<unsigned char>(text[0]) << 8 | static_cast<unsigned char>(text[1]);
+    for (size_t i = 2; i < text.size(); i++) {
+        trigram = (trigram << 8 | static_cast<unsigned char>(text[i])) & 0xFFFFFF;
+        trigrams.push_back(trigram);
+    }
+    std::sort(trigrams.begin(), trigrams.end());
+    trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+}
+
+TrigramIndex::Signature SignatureOf(const std::vector<uint32_t>& trigrams) {
+    TrigramIndex::Signature signature{};
+    for (const auto trigram : trigrams) {
+        // the top byte of a multiplicative hash, trigrams differing in one byte land far apart
+        const auto bit = (trigram * 0x9E3779B1u) >> 24;
+        signature[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+    return signature;
+}
+
+}
+
+TrigramQuery::TrigramQuery(std::string needle)
+    : searcher(std::move(needle)), trigrams(TrigramIndex::GetTrigrams(searcher.GetNeedle())),
+      mask(TrigramIndex::GetSignature(trigrams))
+{
+}
+
+std::vector<uint32_t> TrigramIndex::GetTrigrams(std::string_view text) {
+    std::vector<uint32_t> trigrams;
+    AddTrigrams(text, trigrams);
+    return trigrams;
+}
+
+TrigramIndex::Signature TrigramIndex::GetSignature(const std::vector<uint32_t>& trigrams) {
+    return SignatureOf(trigrams);
+}
+
+void TrigramIndex::Build(const std::vector<std::string>& lines) {
+    Clear();
+    m_Signatures.reserve(lines.size());
+    AddLines(lines, 0, lines.size());
+}
+
+void TrigramIndex::Clear() {
+    std::vector<Signature>().swap(m_Signatures);
+    std::unordered_map<uint32_t, uint32_t>().swap(m_LineCounts);
+    std::vector<uint32_t>().swap(m_Scratch);
+    m_RemovedLines = 0;
+}
+
+void TrigramIndex::RemoveLines(const std::vector<std::string>& lines, size_t first, size_t count) {
+    for (size_t line = first; line < first + count; line++) {
+        AddTrigrams(lines[line], m_Scratch);
+        for (const auto trigram : m_Scratch) {
+            const auto it = m_LineCounts.find(trigram);
+            if (--it->second == 0) {
+                m_LineCounts.erase(it);
+            }
+        }
+    }
+    m_RemovedLines = count;
+}
+
+void TrigramIndex::AddLines(const std::vector<std::string>& lines, size_t first, size_t count) {
+    const auto removed = std::exchange(m_RemovedLines, 0);
+    if (count > removed) {
+        m_Signatures.insert(m_Signatures.begin() + first + removed, count - removed, Signature{});
+    } else if (count < removed) {
+        m_Signatures.erase(m_Signatures.begin() + first + count, m_Signatures.begin() + first + removed);
+    }
+    for (size_t line = first; line < first + count; line++) {
+        AddTrigrams(lines[line], m_Scratch);
+        for (const auto trigram : m_Scratch) {
+            m_LineCounts[trigram]++;
+        }
+        m_Signatures[line] = SignatureOf(m_Scratch);
+    }
+}
+
+bool TrigramIndex::MayContain(const TrigramQuery& query) const {
+    return std::all_of(query.trigrams.begin(), query.trigrams.end(), [this](uint32_t trigram) {
+        return m_LineCounts.find(trigram) != m_LineCounts.end();
+    });
+}
+
+bool TrigramIndex::MayContain(size_t line, const TrigramQuery& query) const {
+    const auto& signature = m_Signatures[line];
+    return (signature[0] & query.mask[0]) == query.mask[0] && (signature[1] & query.mask[1]) == query.mask[1]
+        && (signature[2] & query.mask[2]) == query.mask[2] && (signature[3] & query.mask[3]) == query.mask[3];
+}
+
+size_t TrigramIndex::GetMemoryBytes() const {
+    // a node of the map holds the pair and the link to the next node
+    return m_Signatures.capacity() * sizeof(Signature) + m_Scratch.capacity() * sizeof(uint32_t)
+        + m_LineCounts.bucket_count() * sizeof(void*)
+        + m_LineCounts.size() * (sizeof(std::pair<const uint32_t, uint32_t>) + sizeof(void*));
+}
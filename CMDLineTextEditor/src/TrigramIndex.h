@@ -0,0 +1,57 @@
+// TrigramIndex.h
+
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "TextSearch.h"
+
+// a needle with what the index needs to rule lines out
+struct TrigramQuery {
+    explicit TrigramQuery(std::string needle);
+
+    SubstringSearcher searcher;
+    std::vector<uint32_t> trigrams; // distinct and sorted, none for needles shorter than 3 bytes
+    std::array<uint64_t, 4> mask{}; // signature bits of the trigrams
+};
+
+// the trigrams, 3 byte substrings, of the lines of one text. every line has a 256 bit signature with
+// one bit per trigram it holds, and every trigram the number of lines holding it. a needle can only be on
+// lines whose signature has all bits of the needle's, and only in a text that holds all its trigrams,
+// so most lines, and most texts, are ruled out without looking at them
+class TrigramIndex {
+public:
+    using Signature = std::array<uint64_t, 4>;
+
+    // distinct and sorted
+    static std::vector<uint32_t> GetTrigrams(std::string_view text);
+    static Signature GetSignature(const std::vector<uint32_t>& trigrams);
+
+    void Build(const std::vector<std::string>& lines);
+    void Clear();
+    // to be called before lines [first, first + count) are changed or removed. their signatures keep
+    // their place until the AddLines that follows, which overwrites them and shifts the rest only by
+    // the difference in lines, so a one line edit does not move the signatures of the whole text
+    void RemoveLines(const std::vector<std::string>& lines, size_t first, size_t count);
+    // to be called after lines [first, first + count) were changed or inserted, also with no lines
+    // after lines were only removed
+    void AddLines(const std::vector<std::string>& lines, size_t first, size_t count);
+
+    // false when a trigram of the query is on no line
+    bool MayContain(const TrigramQuery& query) const;
+    bool MayContain(size_t line, const TrigramQuery& query) const;
+    size_t GetLineCount() const { return m_Signatures.size(); }
+    size_t GetTrigramCount() const { return m_LineCounts.size(); }
+    // estimated heap bytes of the signatures and the line counts
+    size_t GetMemoryBytes() const;
+
+private:
+    std::vector<Signature> m_Signatures; // by line
+    std::unordered_map<uint32_t, uint32_t> m_LineCounts; // lines holding each trigram
+    std::vector<uint32_t> m_Scratch;
+    size_t m_RemovedLines = 0; // taken out by RemoveLines, not yet overwritten
+};
@@ -5,23 +5,47 @@
 #include <sstream>
 #include <string>
 #include <memory>
+#include <iomanip>
+#include <mutex>
+#include <thread>
 
 #include "../src/Components/Editor.h"
+#include "../src/Components/SessionImage.h"
 #include "../src/Components/Workspace.h"
+#include "../src/SlotMap.h"
+#include "../src/TextSearch.h"
+#include "../src/Regex.h"
+#include "../src/TrigramIndex.h"
+#include "../src/FileSearch.h"
+#include "../src/LineDiff.h"
+#include "../src/MappedFile.h"
+#include "../src/TreeDrawer.h"
+#include "../src/DirTreeCache.h"
+
+// kept apart from the journal of the application
+const std::string s_TestJournalPath = "testfile/.edit_journal";
 
 void TestCommand();
 void TestEditor();
 void TestWorkspace();
 void TestTreeDrawer();
 void TestLogger();
+void TestSlotMap();
+void TestTextSearch();
+void TestRegex();
 
 int main() {
     std::cout << "  ######## Starting tests ########" << std::endl << std::endl;
 
     TestCommand();
     TestLogger();
+    TestSlotMap();
+    TestTextSearch();
+    TestRegex();
     TestEditor();
     TestWorkspace();
+    TestTreeDrawer();
+    std::filesystem::remove(s_TestJournalPath);
 
     std::cout << " ######## All tests passed! ########" << std::endl << std::endl;
 }
@@ -54,6 +78,16 @@ void TestCommand() {
 
 void TestLogger() {
     std::cout << "======== Testing Logger ========" << std::endl;
+    const auto now = std::chrono::system_clock::now();
+    for (const auto offset : {0, 1, 59, 61, 3600, 86399, 86400 * 40}) {
+        const auto t = now + std::chrono::seconds(offset);
+        const auto timeTick = std::chrono::system_clock::to_time_t(t);
+        std::stringstream expected;
+        expected << std::put_time(std::localtime(&timeTick), "%Y%m%d %H:%M:%S");
+        assert(GetTimestamp(t) == expected.str());
+    }
+    std::cout << "Passed: cached timestamp formatting" << std::endl;
+
     Logger* testLogger = new Logger(".test.log");
     Command command("show");
     testLogger->Log(command);
@@ -78,9 +112,373 @@ void TestLogger() {
 
     std::filesystem::remove((".test.log"));
 
+    LogSink sink;
+    sink.SetMaxOpenFiles(2);
+    {
+        Logger first(".test1.log", sink), second(".test2.log", sink), third(".test3.log", sink);
+        first.Log(command);
+        second.Log(initCommand);
+        third.Log(command);
+        sink.Flush();
+        assert(sink.GetOpenFileCount() == 2);
+        assert(first.GetBuffer().find("show") != std::string::npos);
+        assert(first.GetBuffer().find("init") == std::string::npos);
+    }
+    assert(sink.GetOpenFileCount() == 0);
+    assert(std::filesystem::exists(".test1.log") && std::filesystem::exists(".test3.log"));
+    // the records of a closed logger are released with it
+    assert(sink.GetBuffer(0).empty());
+    std::cout << "Passed: shared sink with bounded open files" << std::endl;
+
+    {
+        // a log that cannot be opened keeps its records until it can
+        std::filesystem::create_directory(".test.blocked.log");
+        Logger blocked(".test.blocked.log", sink);
+        blocked.Log(command);
+        sink.Flush();
+        blocked.Log(initCommand);
+        sink.Flush();
+        std::filesystem::remove(".test.blocked.log");
+        sink.Flush();
+        std::ifstream blockedLog(".test.blocked.log");
+        std::stringstream written;
+        written << blockedLog.rdbuf();
+        assert(written.str().find("session start at ") == 0);
+        assert(written.str().find("show") != std::string::npos && written.str().find("init") != std::string::npos);
+    }
+    std::filesystem::remove(".test.blocked.log");
+    std::cout << "Passed: records are kept while their log cannot be written" << std::endl;
+
+    sink.SetTarget(LogSink::Target::Journal, ".test.journal");
+    {
+        Logger first(".test1.log", sink), second(".test2.log", sink);
+        first.Log(command);
+        second.Log(initCommand);
+    }
+    std::ifstream journal(".test.journal");
+    std::stringstream journalBuffer;
+    journalBuffer << journal.rdbuf();
+    journal.close();
+    assert(journalBuffer.str().find(".test1.log\t") != std::string::npos);
+    assert(journalBuffer.str().find(".test2.log\t") != std::string::npos);
+    std::cout << "Passed: shared sink journal" << std::endl;
+
+    for (const auto* fp : {".test1.log", ".test2.log", ".test3.log", ".test.journal"}) {
+        std::filesystem::remove(fp);
+    }
+
+    LogSink policySink;
+    {
+        Logger policyLogger(".test.log", policySink);
+        LogPolicy policy;
+        assert(LogPolicy::Parse("mutating", policy));
+        policyLogger.SetPolicy(policy);
+        Command appendCommand("append text");
+        policyLogger.Log(command);
+        policyLogger.Log(appendCommand);
+        assert(policyLogger.GetBuffer().find("show") == std::string::npos);
+        assert(policyLogger.GetBuffer().find("append text") != std::string::npos);
+
+        assert(LogPolicy::Parse("sample:3", policy) && policy.ToString() == "sample:3");
+        policyLogger.SetPolicy(policy);
+        for (int i = 0; i < 6; i++) {
+            policyLogger.Log(command);
+        }
+        const auto buffer = policyLogger.GetBuffer();
+        size_t shows = 0;
+        for (auto at = buffer.find(" show"); at != std::string::npos; at = buffer.find(" show", at + 1)) {
+            shows++;
+        }
+        assert(shows == 2);
+
+        assert(LogPolicy::Parse("counters:3600", policy));
+        policyLogger.SetPolicy(policy);
+        policyLogger.Log(command);
+        policyLogger.Log(command);
+        policyLogger.Log(appendCommand);
+        policyLogger.Save();
+        assert(policyLogger.GetBuffer().find("[counters] append=1 show=2") != std::string::npos);
+        policyLogger.Log(command);
+        policyLogger.FlushDueCounters(std::chrono::system_clock::now());
+        assert(policyLogger.GetBuffer().find("[counters] show=1") == std::string::npos);
+        policyLogger.FlushDueCounters(std::chrono::system_clock::now() + policy.interval);
+        assert(policyLogger.GetBuffer().find("[counters] show=1") != std::string::npos);
+        policyLogger.Log(appendCommand);
+        std::stringstream shown;
+        auto* logConsole = std::cout.rdbuf(shown.rdbuf());
+        policyLogger.Show();
+        std::cout.rdbuf(logConsole);
+        assert(shown.str().find("[counters] append=1\n") != std::string::npos);
+        assert(!LogPolicy::Parse("sample:0", policy) && !LogPolicy::Parse("loud", policy));
+    }
+    std::filesystem::remove(".test.log");
+    std::cout << "Passed: log policies" << std::endl;
+
+    LogSink rotatingSink;
+    LogRotationPolicy policy;
+    policy.maxBytes = 256;
+    policy.retainCount = 3;
+    policy.plainCount = 1;
+    rotatingSink.SetRotationPolicy(policy);
+    rotatingSink.SetGroupSize(1);
+    {
+        Logger rotatingLogger(".test.log", rotatingSink);
+        for (int i = 0; i < 100; i++) {
+            rotatingLogger.Log(i % 2 ? command : initCommand);
+        }
+    }
+    assert(std::filesystem::file_size(".test.log") <= policy.maxBytes);
+    assert(std::filesystem::exists(GetLogSegmentPath(".test.log", 1, false)));
+    assert(std::filesystem::exists(GetLogSegmentPath(".test.log", 3, true)));
+    assert(!std::filesystem::exists(GetLogSegmentPath(".test.log", 3, false)));
+    assert(!std::filesystem::exists(GetLogSegmentPath(".test.log", 4, true)));
+    std::cout << "Passed: size based log rotation with retention" << std::endl;
+
+    // written just now, but started long ago: the age counts from the first record
+    std::ofstream(".test.aged.log") << "session start at 20200101 00:00:00\n20200101 00:00:01 show\n";
+    LogSink agingSink;
+    LogRotationPolicy agingPolicy;
+    agingPolicy.maxBytes = 0;
+    agingPolicy.maxAge = std::chrono::hours(24);
+    agingSink.SetRotationPolicy(agingPolicy);
+    {
+        Logger agingLogger(".test.aged.log", agingSink);
+        agingLogger.Log(command);
+    }
+    int64_t started = 0;
+    assert(ReadLogStart(GetLogSegmentPath(".test.aged.log", 1, false), started));
+    assert(ReadLogStart(".test.aged.log", started) && started > GetLogClock(std::chrono::system_clock::now()) - 60);
+    for (const auto* fp : {".test.aged.log", ".test.aged.log.1"}) {
+        std::filesystem::remove(fp);
+    }
+    std::cout << "Passed: age based log rotation counts from the first record" << std::endl;
+
+    const std::string plainLog = "session start at 20250101 23:59:58\n"
+        "20250101 23:59:59 show\n20250102 00:00:01 show\n20250102 00:00:01 init a\nnot a record\n";
+    {
+        std::ofstream plainOut(".test.plain.log", std::ios::binary);
+        plainOut << plainLog;
+    }
+    assert(CompactLogSegment(".test.plain.log", ".test.compact.log"));
+    assert(ExpandLogSegment(".test.compact.log") == plainLog);
+    std::cout << "Passed: log segment compaction round trip" << std::endl;
+
+    for (const auto* corrupt : {"S12x\n", "T\tshow\n", "S99999999999999999999\n", "T-\tshow\n"}) {
+        std::ofstream(".test.compact.log", std::ios::binary | std::ios::trunc) << "#compact-log 1\nS0\n" << corrupt;
+        assert(ExpandLogSegment(".test.compact.log").empty());
+    }
+    std::cout << "Passed: malformed compacted segments are rejected" << std::endl;
+
+    for (const auto* fp : {".test.log", ".test.log.1", ".test.log.2.compact", ".test.log.3.compact",
+        ".test.plain.log", ".test.compact.log"}) {
+        std::filesystem::remove(fp);
+    }
+
     std::cout << "======== End of Logger Testing ========" << std::endl << std::endl;
 }
 
+void TestSlotMap() {
+    std::cout << "======== Testing SlotMap ========" << std::endl;
+    SlotMap<std::string> slotMap;
+    const auto a = slotMap.Insert("a"), b = slotMap.Insert("b"), c = slotMap.Insert("c");
+    assert(a == 0 && b == 1 && c == 2);
+    assert(slotMap.Erase(a));
+    assert(!slotMap.Contains(a) && slotMap.Get(a) == nullptr);
+    assert(*slotMap.Get(b) == "b" && *slotMap.Get(c) == "c");
+    assert(slotMap.Size() == 2);
+    std::cout << "Passed: erase keeps other handles valid" << std::endl;
+
+    const auto d = slotMap.Insert("d");
+    assert(d != a && !slotMap.Contains(a) && *slotMap.Get(d) == "d");
+    assert(!slotMap.Erase(a));
+    std::cout << "Passed: reused slot does not revive old handle" << std::endl;
+
+    std::string joined;
+    for (const auto& value : slotMap) {
+        joined += value;
+    }
+    assert(joined.size() == 3);
+    std::cout << "Passed: dense iteration" << std::endl;
+
+    slotMap.Erase(c);
+    assert(slotMap.GetHandleAt(0) == d);
+    assert(slotMap.GetHandlesInInsertionOrder() == (std::vector<SlotMap<std::string>::Handle>{b, d}));
+    std::cout << "Passed: handles in insertion order after erase" << std::endl;
+
+    std::cout << "======== End of SlotMap Testing ========" << std::endl << std::endl;
+}
+
+void TestTextSearch() {
+    std::cout << "======== Testing TextSearch ========" << std::endl;
+
+    // every needle length around the 16 byte blocks, at every offset of a text with near misses
+    std::string text;
+    for (int i = 0; i < 200; i++) {
+        text += static_cast<char>('a' + (i * 7 + i / 13) % 4);
+    }
+    for (size_t length = 1; length <= 40; length++) {
+        for (size_t at = 0; at + length <= text.size(); at += 3) {
+            const auto needle = text.substr(at, length);
+            const SubstringSearcher searcher(needle);
+            for (size_t from = 0; from <= text.size(); from += 17) {
+                assert(searcher.Find(text, from) == text.find(needle, from));
+            }
+        }
+        const SubstringSearcher missing(std::string(length, 'z'));
+        assert(missing.Find(text) == std::string::npos);
+    }
+    assert(SubstringSearcher("").Find("abc", 2) == 2);
+    assert(SubstringSearcher("abcd").Find("abc") == std::string::npos);
+    std::cout << "Passed: substring search matches std::string::find" << std::endl;
+
+    const std::vector<std::string> lines = {"aaaa", "", "xaax", "aa"};
+    std::vector<std::pair<size_t, size_t>> hits;
+    const auto count = ForEachHit(lines, 0, 3, SubstringSearcher("aa"), [&](const TextHit& hit) {
+        hits.emplace_back(hit.line, hit.column);
+        return true;
+    });
+    assert(count == 4);
+    assert((hits == std::vector<std::pair<size_t, size_t>>{{0, 0}, {0, 2}, {2, 1}, {3, 0}}));
+    assert(ForEachHit(lines, 0, 3, SubstringSearcher("aa"), [](const TextHit&) { return false; }) == 1);
+    assert(ForEachHit(lines, 1, 2, SubstringSearcher("aa"), [](const TextHit&) { return true; }) == 1);
+    std::cout << "Passed: hits over lines" << std::endl;
+
+    std::vector<FileHit> fileHits;
+    const std::string_view searchedText = "aa\n\nxaax\r\naa";
+    SearchText(searchedText, SubstringSearcher("aa"), 7, fileHits);
+    assert(fileHits.size() == 3);
+    assert(fileHits[0].file == 7 && fileHits[0].line == 0 && fileHits[0].column == 0 && GetHitLine(searchedText, fileHits[0]) == "aa");
+    assert(fileHits[1].line == 2 && fileHits[1].column == 1 && GetHitLine(searchedText, fileHits[1]) == "xaax\r");
+    assert(fileHits[2].line == 3 && fileHits[2].column == 0 && GetHitLine(searchedText, fileHits[2]) == "aa");
+    assert(GetHitLine("aa\n", fileHits[1]).empty());
+    std::cout << "Passed: hits in a whole text, by line" << std::endl;
+
+    std::vector<std::string> indexed = {"alpha beta", "gamma", "beta delta", "ab"};
+    TrigramIndex index;
+    index.Build(indexed);
+    const TrigramQuery beta("beta"), gamma("gamm"), zeta("zeta"), shortNeedle("ab");
+    assert(index.MayContain(beta) && !index.MayContain(zeta));
+    assert(index.MayContain(0, beta) && index.MayContain(2, beta));
+    assert(shortNeedle.trigrams.empty() && index.MayContain(3, shortNeedle));
+    // a line changed and one removed, the way the edit handlers report them
+    index.RemoveLines(indexed, 1, 1);
+    indexed[1] = "zeta";
+    index.AddLines(indexed, 1, 1);
+    assert(index.MayContain(zeta) && index.MayContain(1, zeta) && !index.MayContain(gamma));
+    index.RemoveLines(indexed, 0, 1);
+    indexed.erase(indexed.begin());
+    index.AddLines(indexed, 0, 0);
+    // a line split in two shifts the signatures after it by one
+    index.RemoveLines(indexed, 1, 1);
+    indexed.insert(indexed.begin() + 2, "ab");
+    indexed[1] = "beta";
+    index.AddLines(indexed, 1, 2);
+    index.RemoveLines(indexed, 1, 2);
+    indexed.erase(indexed.begin() + 2);
+    indexed[1] = "beta delta";
+    index.AddLines(indexed, 1, 1);
+    TrigramIndex rebuilt;
+    rebuilt.Build(indexed);
+    assert(index.GetLineCount() == 3 && index.GetTrigramCount() == rebuilt.GetTrigramCount());
+    assert(index.MayContain(0, zeta) && index.MayContain(1, beta));
+    std::cout << "Passed: trigram index follows changed lines" << std::endl;
+
+    const auto diffMatches = DiffLines({1, 2, 3, 4, 5}, {1, 3, 4, 6, 5});
+    assert(diffMatches.size() == 3);
+    assert(diffMatches[0].oldLine == 0 && diffMatches[0].newLine == 0 && diffMatches[0].count == 1);
+    assert(diffMatches[1].oldLine == 2 && diffMatches[1].newLine == 1 && diffMatches[1].count == 2);
+    assert(diffMatches[2].oldLine == 4 && diffMatches[2].newLine == 4 && diffMatches[2].count == 1);
+    assert(DiffLines({}, {1, 2}).empty() && DiffLines({7, 8}, {8, 7}).size() == 1);
+    const std::string diskText = "a\nb\n\nc";
+    const auto diskLines = TextLines::Split(diskText);
+    assert(diskLines.Size() == 4 && diskLines.Get(diskText, 2).empty() && diskLines.Get(diskText, 3) == "c");
+    assert(diskLines.hashes[1] == HashLine("b") && TextLines::Split("a\n").Size() == 1);
+    std::cout << "Passed: line diff" << std::endl;
+
+    std::cout << "======== End of TextSearch Testing ========" << std::endl << std::endl;
+}
+
+void TestRegex() {
+    std::cout << "======== Testing Regex ========" << std::endl;
+    const auto matched = [](const std::string& pattern, const std::string& line, size_t from = 0) {
+        Regex regex(pattern);
+        RegexMatch match;
+        return regex.Find(line, from, match) ? line.substr(match.begin, match.end - match.begin) : "<none>";
+    };
+    assert(matched("b+", "abbbc") == "bbb");
+    assert(matched("a.c", "xxabcx") == "abc");
+    assert(matched("[0-9]+", "id 42, 7") == "42");
+    assert(matched("[^a-z ]+", "abc DEF") == "DEF");
+    assert(matched("\\d{2,3}", "1 12345") == "123");
+    assert(matched("\\w+\\s\\W", "  foo +") == "foo +");
+    assert(matched("x{2}", "xxx") == "xx");
+    assert(matched("colou?r", "colour color") == "colour");
+    assert(matched("^ab", "abab", 1) == "<none>");
+    assert(matched("ab$", "abab") == "ab");
+    assert(matched("$", "abc") == "");
+    assert(matched("^$", "") == "");
+    assert(matched("\\(a\\)", "f(a)") == "(a)");
+    assert(matched("z", "abc") == "<none>");
+    std::cout << "Passed: regex syntax" << std::endl;
+
+    // the longest of the leftmost matches, whatever the order of the alternatives
+    assert(matched("a|ab|abc", "xabcd") == "abc");
+    assert(matched("(a|ab)(c|bcd)", "abcd") == "abcd");
+    assert(matched("a*", "baaa") == "");
+    assert(matched("a*", "baaa", 1) == "aaa");
+    std::cout << "Passed: leftmost-longest matches" << std::endl;
+
+    Regex dates("(\\d+)-(\\d+)(-x)?");
+    RegexMatch match;
+    const std::string line = "on 2024-05 at";
+    assert(dates.Find(line, 0, match));
+    const auto groups = dates.GetGroups(line, match);
+    assert(groups.size() == 4);
+    assert(line.substr(groups[1].begin, groups[1].end - groups[1].begin) == "2024");
+    assert(line.substr(groups[2].begin, groups[2].end - groups[2].begin) == "05");
+    assert(groups[3].begin == std::string::npos);
+    assert(dates.Expand("$2/$1 $$ $0", line, match) == "05/2024 $ 2024-05");
+    std::cout << "Passed: groups and replacements" << std::endl;
+
+    for (const auto* malformed : {"(a", "a)", "[a-", "*a", "a{2,1}", "\\"}) {
+        bool thrown = false;
+        try {
+            Regex regex(malformed);
+        } catch (const std::invalid_argument&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    // nesting is bounded before the parser or the compiler run out of stack
+    for (const auto& nested : {std::string(20000, '(') + "a" + std::string(20000, ')'), "a" + std::string(20000, '*')}) {
+        bool thrown = false;
+        try {
+            Regex regex(nested);
+        } catch (const std::invalid_argument& e) {
+            thrown = std::string(e.what()).find("pattern nested too deeply") == 0;
+        }
+        assert(thrown);
+    }
+    assert(Regex(std::string(500, '(') + "a" + std::string(500, ')') + "*").Find("xa", 0, match));
+    std::cout << "Passed: malformed patterns" << std::endl;
+
+    RegexCache cache(2);
+    const auto first = cache.Get("a+");
+    assert(cache.Get("a+") == first);
+    assert(cache.GetCompileCount() == 1);
+    cache.Get("b+");
+    cache.Get("a+");
+    cache.Get("c+"); // drops b+, the least recently used
+    assert(cache.Size() == 2);
+    assert(cache.Get("a+") == first);
+    assert(cache.GetCompileCount() == 3);
+    cache.Get("b+");
+    assert(cache.GetCompileCount() == 4);
+    std::cout << "Passed: regex cache" << std::endl;
+
+    std::cout << "======== End of Regex Testing ========" << std::endl << std::endl;
+}
+
 void TestEditor() {
     std::cout << "======== Testing Editor ========" << std::endl;
     Ref<Editor> emptyFileEditor = CreateRef<Editor>("testfile/emptyfile");
@@ -129,10 +527,111 @@ void TestEditor() {
     assert(tempFileEditor->GetLogger()->GetBuffer().find("append") == std::string::npos);
     std::cout << "Passed: editor log mode and logging" << std::endl;
 
+    std::stringstream found;
+    auto* console = std::cout.rdbuf(found.rdbuf());
+    tempFileEditor->Handle(Command("find ns"));
+    tempFileEditor->Handle(Command("show @2"));
+    tempFileEditor->Handle(Command("find e 3:3"));
+    std::cout.rdbuf(console);
+    assert(found.str() ==
+        "@1 1:2: insert\n"
+        "@2 2:2: insert\n"
+        "[find] 2 hit(s)\n"
+        "2:2\n"
+        "insert\n"
+        " ^\n"
+        "@1 3:4: append replace!\n"
+        "@2 3:9: append replace!\n"
+        "@3 3:14: append replace!\n"
+        "[find] 3 hit(s)\n");
+    found.str("");
+    console = std::cout.rdbuf(found.rdbuf());
+    tempFileEditor->Handle(Command("show @4"));
+    tempFileEditor->Handle(Command("append more"));
+    tempFileEditor->Handle(Command("show @1"));
+    std::cout.rdbuf(console);
+    assert(found.str().find("No hit @4") != std::string::npos);
+    assert(found.str().find("changed since the last `find`") != std::string::npos);
+    tempFileEditor->Handle(Command("undo"));
+    std::cout << "Passed: find and show hits" << std::endl;
+
+    found.str("");
+    console = std::cout.rdbuf(found.rdbuf());
+    tempFileEditor->Handle(Command("find-re (n|l)(s|a)"));
+    tempFileEditor->Handle(Command("show @3"));
+    std::cout.rdbuf(console);
+    assert(found.str() ==
+        "@1 1:2: insert\n"
+        "@2 2:2: insert\n"
+        "@3 3:11: append replace!\n"
+        "[find-re] 3 hit(s)\n"
+        "3:11\n"
+        "append replace!\n"
+        "          ^\n");
+    found.str("");
+    console = std::cout.rdbuf(found.rdbuf());
+    tempFileEditor->Handle(Command("find-re (a"));
+    std::cout.rdbuf(console);
+    assert(found.str().find("[find-re] Error: Invalid pattern") == 0);
+    std::cout << "Passed: find-re" << std::endl;
+
+    found.str("");
+    console = std::cout.rdbuf(found.rdbuf());
+    tempFileEditor->Handle(Command("replace-re (i|e)(n|p) $2$1"));
+    tempFileEditor->Handle(Command("replace-re zzz y"));
+    std::cout.rdbuf(console);
+    assert(tempFileEditor->GetLines()[0] == "nisert");
+    assert(tempFileEditor->GetLines()[1] == "nisert");
+    assert(tempFileEditor->GetLines()[2] == "appned rpelace!");
+    assert(found.str() == "[replace-re] 4 replacement(s) in 3 line(s)\n[replace-re] 0 replacement(s)\n");
+    tempFileEditor->Handle(Command("undo"));
+    assert(tempFileEditor->GetLines()[0] == "insert");
+    assert(tempFileEditor->GetLines()[2] == "append replace!");
+    std::cout << "Passed: replace-re and undoing it at once" << std::endl;
+
     tempFileEditor->Save();
     assert(!tempFileEditor->IsModified());
     std::cout << "Passed: saving" << std::endl;
 
+    found.str("");
+    console = std::cout.rdbuf(found.rdbuf());
+    tempFileEditor->Handle(Command("diff"));
+    tempFileEditor->Handle(Command("replace 2:1 6 changed"));
+    tempFileEditor->Handle(Command("append tail"));
+    tempFileEditor->Handle(Command("diff"));
+    tempFileEditor->Handle(Command("undo"));
+    tempFileEditor->Handle(Command("undo"));
+    tempFileEditor->Handle(Command("diff"));
+    tempFileEditor->Handle(Command("diff testfile/missing"));
+    tempFileEditor->Handle(Command("insert 1:1 x\\ny"));
+    tempFileEditor->Handle(Command("diff"));
+    tempFileEditor->Handle(Command("undo"));
+    std::cout.rdbuf(console);
+    assert(found.str() ==
+        "[diff] No changes\n"
+        "--- testfile/tempeditorfile\n"
+        "+++ testfile/tempeditorfile (buffer)\n"
+        "@@ -1,3 +1,4 @@\n"
+        " insert\n"
+        "-insert\n"
+        "+changed\n"
+        " append replace!\n"
+        "+tail\n"
+        "[diff] 1 line(s) removed, 2 added\n"
+        "[diff] No changes\n"
+        "[diff] Error: Cannot read file: testfile/missing\n"
+        "[diff] Error: Command not handled in workspace.\n"
+        "--- testfile/tempeditorfile\n"
+        "+++ testfile/tempeditorfile (buffer)\n"
+        "@@ -1,3 +1,4 @@\n"
+        "-insert\n"
+        "+x\n"
+        "+yinsert\n"
+        " insert\n"
+        " append replace!\n"
+        "[diff] 1 line(s) removed, 2 added\n");
+    std::cout << "Passed: diff against the file on disk" << std::endl;
+
     std::filesystem::remove("testfile/tempeditorfile");
 
     std::cout << "======== End of Editor Testing ========" << std::endl << std::endl;
@@ -141,23 +640,47 @@ void TestEditor() {
 void TestWorkspace() {
     std::cout << "======== Testing Workspace ========" << std::endl;
 
-    Ref<Workspace> testWorkspace = CreateRef<Workspace>("");
+    Ref<Workspace> testWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
     assert(testWorkspace->GetCurrentEditor() == nullptr);
     std::cout << "Passed: create empty workspace" << std::endl;
 
     Command loadCommand("load testfile/logstatedfile");
     testWorkspace->Handle(loadCommand);
-    assert(testWorkspace->GetCurrentEditorIndex() == 0);
+    assert(testWorkspace->GetCurrentEditorHandle() == 0);
     assert(testWorkspace->GetLogMode() == LogMode::WithLog);
     std::cout << "Passed: Open existing file" << std::endl;
 
+    Command loadAliasCommand("load testfile/../testfile/./logstatedfile");
+    testWorkspace->Handle(loadAliasCommand);
+    assert(testWorkspace->GetCurrentEditorHandle() == 0);
+    Command editAliasCommand("edit ./testfile/logstatedfile");
+    testWorkspace->Handle(editAliasCommand);
+    assert(testWorkspace->GetCurrentEditorHandle() == 0);
+    std::cout << "Passed: path lookup by canonical path" << std::endl;
+
     Command initCommand("init testfile/tempnewdir/workspacetempfile");
     testWorkspace->Handle(initCommand);
-    assert(testWorkspace->GetCurrentEditorIndex() == 1);
+    assert(testWorkspace->GetCurrentEditorHandle() == 1);
     std::cout << "Passed: Init new file" << std::endl;
 
+    Command editFirstCommand("edit #0");
+    testWorkspace->Handle(editFirstCommand);
+    assert(testWorkspace->GetCurrentEditorHandle() == 0);
+    Command recentListCommand("editor-list --recent");
+    assert(recentListCommand.Validate());
+    testWorkspace->Handle(recentListCommand);
+
+    Command closeByHandleCommand("close #0");
+    testWorkspace->Handle(closeByHandleCommand);
+    assert(testWorkspace->GetCurrentEditorHandle() == 1);
+    assert(testWorkspace->GetCurrentEditor()->GetFilePath() == "testfile/tempnewdir/workspacetempfile");
+    std::cout << "Passed: close by handle keeps other handles, falls back to most recent editor" << std::endl;
+
     Command saveCommand("save");
     testWorkspace->Handle(saveCommand);
+    Command exportJsonCommand("export-json testfile/tempnewdir/state.json");
+    assert(exportJsonCommand.Validate());
+    testWorkspace->Handle(exportJsonCommand);
     Command exitCommand("exit");
     testWorkspace->Handle(exitCommand);
     assert(std::filesystem::exists("data/.editor_workspace"));
@@ -165,6 +688,21 @@ void TestWorkspace() {
 
     testWorkspace.reset();
 
+    {
+        const MappedFile binaryState("data/.editor_workspace");
+        assert(!binaryState.GetView().empty() && binaryState.GetView()[0] != '{');
+        Ref<Workspace> fromBinary = CreateRef<Workspace>(binaryState.GetView(), s_TestJournalPath);
+        assert(fromBinary->GetCurrentEditor() != nullptr);
+        assert(fromBinary->GetCurrentEditor()->GetFilePath() == "testfile/tempnewdir/workspacetempfile");
+        const MappedFile jsonState("testfile/tempnewdir/state.json");
+        assert(jsonState.GetView()[0] == '{');
+        Ref<Workspace> fromJson = CreateRef<Workspace>(jsonState.GetView(), s_TestJournalPath);
+        assert(fromJson->GetCurrentEditor() != nullptr);
+        assert(fromJson->GetCurrentEditor()->GetFilePath() == "testfile/tempnewdir/workspacetempfile");
+        assert(MappedFile("testfile/no-such-state").GetView().empty());
+    }
+    std::cout << "Passed: binary state and JSON export restore the same workspace" << std::endl;
+
     std::string inData = R"({
         "current_editor": 0,
         "editors": [
@@ -177,13 +715,449 @@ void TestWorkspace() {
         "log_mode": 1
     })";
 
-    Ref<Workspace> workspaceWithData = CreateRef<Workspace>(inData);
-    assert(workspaceWithData->GetCurrentEditorIndex() == 0);
+    Ref<Workspace> workspaceWithData = CreateRef<Workspace>(inData, s_TestJournalPath);
+    assert(workspaceWithData->GetCurrentEditorHandle() == 0);
     assert(workspaceWithData->GetLogMode() == LogMode::WithLog);
     std::cout << "Passed: workspace with init data" << std::endl;
 
+    auto restoredEditor = workspaceWithData->GetCurrentEditor();
+    assert(!restoredEditor->IsLoaded());
+    assert(restoredEditor->GetLogMode() == LogMode::WithLog);
+    Command showRestoredCommand("show");
+    restoredEditor->Handle(showRestoredCommand);
+    assert(restoredEditor->IsLoaded());
+    assert(restoredEditor->GetLogMode() == LogMode::WithLog);
+    assert(!restoredEditor->IsModified());
+    restoredEditor.reset();
+    std::cout << "Passed: restored editors load their file on first use" << std::endl;
+
     workspaceWithData.reset();
 
+    JournalChange change;
+    assert(!EditJournal::ParseChange("append \"text\"", change));
+    const auto madeChange = MakeJournalChange({"a", "b", "c"}, {"a", "x\ty\\", "", "c"});
+    assert(madeChange.first == 1 && madeChange.removed == 1);
+    assert((madeChange.lines == std::vector<std::string>{"x\ty\\", ""}));
+
+    Ref<Workspace> crashingWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    Command initJournaledCommand("init testfile/tempnewdir/journaledfile");
+    crashingWorkspace->Handle(initJournaledCommand);
+    Command appendJournaledCommand("append \"not saved yet\"");
+    crashingWorkspace->GetCurrentEditor()->Handle(appendJournaledCommand);
+    crashingWorkspace.reset(); // no `exit`, like a crash
+    Ref<Workspace> recoveredWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    assert(recoveredWorkspace->GetCurrentEditor() != nullptr);
+    assert(recoveredWorkspace->GetCurrentEditor()->GetFilePath() == "testfile/tempnewdir/journaledfile");
+    assert(recoveredWorkspace->GetCurrentEditor()->GetLines().size() == 1);
+    assert(recoveredWorkspace->GetCurrentEditor()->GetLines()[0] == "not saved yet");
+    assert(recoveredWorkspace->GetCurrentEditor()->IsModified());
+    std::cout << "Passed: recover unsaved edits from journal" << std::endl;
+    recoveredWorkspace->GetCurrentEditor()->Save();
+    // the undo reaches back before the save, the journal holds what it changed
+    Command undoJournaledCommand("undo");
+    recoveredWorkspace->GetCurrentEditor()->Handle(undoJournaledCommand);
+    recoveredWorkspace.reset();
+    recoveredWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    assert(recoveredWorkspace->GetCurrentEditor()->GetLines().empty());
+    assert(recoveredWorkspace->GetCurrentEditor()->IsModified());
+    std::cout << "Passed: undo after a save is recovered as the change it made" << std::endl;
+    recoveredWorkspace->GetCurrentEditor()->Save();
+    recoveredWorkspace.reset();
+    assert(EditJournal::ReadPending(s_TestJournalPath).empty());
+    std::cout << "Passed: saving clears pending journal edits" << std::endl;
+
+    Ref<Workspace> multiWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    multiWorkspace->SetThreadCount(4);
+    Command multiLoadCommand("load testfile/tempnewdir/multi_a testfile/logstatedfile "
+        "testfile/tempnewdir/multi_b testfile/tempnewdir/multi_a");
+    assert(multiLoadCommand.Validate());
+    multiWorkspace->Handle(multiLoadCommand);
+    assert(multiWorkspace->GetCurrentEditorHandle() == 0);
+    assert(multiWorkspace->GetCurrentEditor()->GetFilePath() == "testfile/tempnewdir/multi_a");
+    Command editSecondCommand("edit #1");
+    multiWorkspace->Handle(editSecondCommand);
+    assert(multiWorkspace->GetCurrentEditor()->GetFilePath() == "testfile/logstatedfile");
+    assert(multiWorkspace->GetCurrentEditor()->GetLines()[0] == "# log");
+    assert(multiWorkspace->GetLogMode() == LogMode::WithLog);
+    Command editThirdCommand("edit #2");
+    multiWorkspace->Handle(editThirdCommand);
+    assert(multiWorkspace->GetCurrentEditor()->GetFilePath() == "testfile/tempnewdir/multi_b");
+    std::cout << "Passed: load several files in parallel, registered in argument order" << std::endl;
+
+    multiWorkspace->Handle(Command("edit #0"));
+    multiWorkspace->Handle(Command("save"));
+    multiWorkspace->Handle(Command("close #0"));
+    std::stringstream listed;
+    auto* listConsole = std::cout.rdbuf(listed.rdbuf());
+    multiWorkspace->Handle(Command("editor-list"));
+    std::cout.rdbuf(listConsole);
+    const auto logstatedAt = listed.str().find("testfile/logstatedfile");
+    assert(logstatedAt != std::string::npos && logstatedAt < listed.str().find("testfile/tempnewdir/multi_b"));
+    multiWorkspace.reset();
+    std::cout << "Passed: editor list keeps the open order after a close" << std::endl;
+
+    nlohmann::json restoredState;
+    restoredState["log_mode"] = 2;
+    restoredState["current_editor"] = 0;
+    for (const auto* path : {"testfile/tempnewdir/multi_a", "testfile/tempnewdir/multi_b"}) {
+        restoredState["editors"].push_back({{"path", path}, {"log_mode", 2}, {"modified", false}});
+    }
+    Ref<Workspace> restoredWorkspace = CreateRef<Workspace>(restoredState.dump(), s_TestJournalPath);
+    assert(!restoredWorkspace->GetCurrentEditor()->IsLoaded());
+    restoredWorkspace->Handle(Command("load testfile/tempnewdir/multi_a testfile/tempnewdir/multi_b"));
+    std::stringstream restoredList;
+    listConsole = std::cout.rdbuf(restoredList.rdbuf());
+    restoredWorkspace->Handle(Command("editor-list"));
+    std::cout.rdbuf(listConsole);
+    assert(restoredList.str().find("[not loaded]") == std::string::npos);
+    restoredWorkspace.reset();
+    std::cout << "Passed: loading several restored editors reads them in parallel" << std::endl;
+
+    Ref<Workspace> sessionWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    Command initSessionCommand("init testfile/tempnewdir/sessionfile");
+    sessionWorkspace->Handle(initSessionCommand);
+    Command appendFirstCommand("append \"first\"");
+    Command appendSecondCommand("append \"second\"");
+    Command undoCommand("undo");
+    Command redoCommand("redo");
+    sessionWorkspace->GetCurrentEditor()->Handle(appendFirstCommand);
+    sessionWorkspace->GetCurrentEditor()->Handle(appendSecondCommand);
+    sessionWorkspace->GetCurrentEditor()->Handle(undoCommand);
+    Command sessionSaveCommand("session-save --exit");
+    assert(sessionSaveCommand.Validate());
+    sessionWorkspace->Handle(sessionSaveCommand);
+    assert(!sessionWorkspace->GetRunning());
+    assert(std::filesystem::exists(Workspace::SessionImagePath));
+    sessionWorkspace.reset();
+
+    Ref<Workspace> resumedWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    auto resumedEditor = resumedWorkspace->GetCurrentEditor();
+    assert(resumedEditor != nullptr && resumedEditor->IsLoaded());
+    assert(resumedEditor->IsModified());
+    assert(resumedEditor->GetLines() == std::vector<std::string>{"first"});
+    resumedEditor->Handle(redoCommand);
+    assert(resumedEditor->GetLines() == (std::vector<std::string>{"first", "second"}));
+    resumedEditor->Handle(undoCommand);
+    resumedEditor->Handle(undoCommand);
+    assert(resumedEditor->GetLines().empty());
+    resumedEditor->Handle(redoCommand);
+    resumedEditor->Handle(redoCommand);
+    assert(resumedEditor->GetLines() == (std::vector<std::string>{"first", "second"}));
+    resumedEditor.reset();
+    std::cout << "Passed: session image restores unsaved content and undo history" << std::endl;
+
+    Command checkpointCommand("session-save");
+    resumedWorkspace->Handle(checkpointCommand);
+    assert(resumedWorkspace->GetRunning());
+    resumedWorkspace.reset();
+    {
+        std::ofstream external("testfile/tempnewdir/sessionfile");
+        external << "external" << std::endl;
+    }
+    Ref<Workspace> changedWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    // the session content is never dropped, it stays unsaved over the changed file
+    assert(changedWorkspace->GetCurrentEditor()->IsLoaded() && changedWorkspace->GetCurrentEditor()->IsModified());
+    assert(changedWorkspace->GetCurrentEditor()->GetLines() == (std::vector<std::string>{"first", "second"}));
+    Command saveSessionFileCommand("save");
+    changedWorkspace->Handle(saveSessionFileCommand);
+    Command exitSessionCommand("exit");
+    changedWorkspace->Handle(exitSessionCommand);
+    assert(!std::filesystem::exists(Workspace::SessionImagePath));
+    changedWorkspace.reset();
+    std::cout << "Passed: files changed on disk keep the session content unsaved, exit discards the image" << std::endl;
+
+    Ref<Workspace> imageWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    imageWorkspace->Handle(Command("init testfile/tempnewdir/crashfile"));
+    imageWorkspace->GetCurrentEditor()->Handle(Command("append \"v1\""));
+    imageWorkspace->Handle(Command("session-save --exit"));
+    imageWorkspace.reset();
+    imageWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    imageWorkspace->GetCurrentEditor()->Handle(Command("append \"v2\""));
+    imageWorkspace->Handle(Command("save"));
+    imageWorkspace.reset(); // no `exit`, as after a crash the image is still there
+    assert(std::filesystem::exists(Workspace::SessionImagePath));
+    imageWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    // the file was saved after the image was written, so the file wins
+    imageWorkspace->Handle(Command("edit testfile/tempnewdir/crashfile"));
+    assert(!imageWorkspace->GetCurrentEditor()->IsModified());
+    assert(imageWorkspace->GetCurrentEditor()->GetLines() == (std::vector<std::string>{"v1", "v2"}));
+    imageWorkspace->Handle(Command("exit"));
+    imageWorkspace.reset();
+    std::cout << "Passed: files saved after the session image are read from disk after a crash" << std::endl;
+
+    Ref<Workspace> autosaveWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    Command initAutosavedCommand("init testfile/tempnewdir/autosavedfile");
+    autosaveWorkspace->Handle(initAutosavedCommand);
+    auto autosavedEditor = autosaveWorkspace->GetCurrentEditor();
+    Command appendDraftCommand("append \"draft\"");
+    autosavedEditor->Handle(appendDraftCommand);
+    autosaveWorkspace->Autosave();
+    const auto recoveryPath = AutosaveService::GetRecoveryPath(autosavedEditor->GetCanonicalPath());
+    assert(std::filesystem::exists(recoveryPath));
+    std::cout << "Passed: autosave writes recovery files of changed editors" << std::endl;
+
+    Command autosaveEverySecondCommand("autosave 1");
+    assert(autosaveEverySecondCommand.Validate());
+    autosaveWorkspace->Handle(autosaveEverySecondCommand);
+    assert(autosaveWorkspace->GetAutosaveInterval() == std::chrono::seconds(1));
+    {
+        std::lock_guard<std::mutex> lock(autosaveWorkspace->GetCommandMutex());
+        Command appendMoreCommand("append \"more\"");
+        autosavedEditor->Handle(appendMoreCommand);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    Command autosaveOffCommand("autosave off");
+    autosaveWorkspace->Handle(autosaveOffCommand);
+    {
+        std::vector<std::string> recovered;
+        assert(AutosaveService::ReadRecoveryFile(autosavedEditor->GetCanonicalPath(), recovered));
+        assert(recovered == (std::vector<std::string>{"draft", "more"}));
+    }
+    std::cout << "Passed: background autosave picks up new edits" << std::endl;
+
+    Command undoAutosavedCommand("undo");
+    autosavedEditor->Handle(undoAutosavedCommand);
+    autosavedEditor->Handle(undoAutosavedCommand);
+    assert(autosavedEditor->GetLines().empty());
+    Command recoverCommand("recover");
+    assert(recoverCommand.Validate());
+    autosaveWorkspace->Handle(recoverCommand);
+    assert(autosavedEditor->GetLines() == (std::vector<std::string>{"draft", "more"}));
+    std::cout << "Passed: recover restores autosaved content" << std::endl;
+
+    Command saveAutosavedCommand("save");
+    autosaveWorkspace->Handle(saveAutosavedCommand);
+    autosaveWorkspace->Autosave();
+    assert(!std::filesystem::exists(recoveryPath));
+    Command autosaveKeptCommand("autosave 30");
+    autosaveWorkspace->Handle(autosaveKeptCommand);
+    Command exitAutosavedCommand("exit");
+    autosaveWorkspace->Handle(exitAutosavedCommand);
+    autosavedEditor.reset();
+    autosaveWorkspace.reset();
+    {
+        const MappedFile autosaveState("data/.editor_workspace");
+        Ref<Workspace> reopened = CreateRef<Workspace>(autosaveState.GetView(), s_TestJournalPath);
+        assert(reopened->GetAutosaveInterval() == std::chrono::seconds(30));
+    }
+    std::cout << "Passed: saving removes recovery files, interval is kept in the state" << std::endl;
+
+    Ref<Workspace> budgetWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    Command initColdCommand("init testfile/tempnewdir/coldfile");
+    budgetWorkspace->Handle(initColdCommand);
+    auto coldEditor = budgetWorkspace->GetCurrentEditor();
+    Command appendColdCommand("append \"a line that is kept in memory until evicted\"");
+    for (int i = 0; i < 10; i++) {
+        coldEditor->Handle(appendColdCommand);
+    }
+    const auto coldBytes = coldEditor->GetResidentBytes();
+    assert(coldBytes > 0);
+    Command initHotCommand("init testfile/tempnewdir/hotfile");
+    budgetWorkspace->Handle(initHotCommand);
+    Command memBudgetCommand("mem-budget 1K");
+    assert(memBudgetCommand.Validate());
+    budgetWorkspace->Handle(memBudgetCommand);
+    assert(budgetWorkspace->GetMemoryBudget() == 1024);
+    assert(coldBytes > 1024 && coldEditor->IsEvicted() && !coldEditor->IsLoaded());
+    assert(coldEditor->GetSwapBytes() > 0);
+    assert(!budgetWorkspace->GetCurrentEditor()->IsEvicted());
+    Command listBudgetCommand("editor-list");
+    budgetWorkspace->Handle(listBudgetCommand);
+    std::cout << "Passed: least recently used editors are evicted over the budget" << std::endl;
+
+    Command budgetSessionCommand("session-save");
+    budgetWorkspace->Handle(budgetSessionCommand);
+    assert(coldEditor->IsEvicted() && !coldEditor->IsLoaded());
+    {
+        SessionImage image;
+        const MappedFile imageFile(Workspace::SessionImagePath);
+        assert(SessionImage::Deserialize(imageFile.GetView(), image));
+        assert(image.editors.size() == 2 && image.editors[0].path == "testfile/tempnewdir/coldfile");
+        assert(image.editors[0].data.lines.size() == 10 && image.editors[0].undo.size() == 10);
+    }
+    std::filesystem::remove(Workspace::SessionImagePath);
+    std::cout << "Passed: session save copies evicted editors from their swap files" << std::endl;
+
+    Command memBudgetOffCommand("mem-budget off");
+    budgetWorkspace->Handle(memBudgetOffCommand);
+    Command editColdCommand("edit testfile/tempnewdir/coldfile");
+    budgetWorkspace->Handle(editColdCommand);
+    assert(coldEditor->GetLines().size() == 10 && !coldEditor->IsEvicted());
+    Command undoColdCommand("undo");
+    coldEditor->Handle(undoColdCommand);
+    assert(coldEditor->GetLines().size() == 9);
+    assert(coldEditor->IsModified());
+    std::cout << "Passed: evicted editors reload content and history on access" << std::endl;
+
+    Command saveAllCommand("save all 2");
+    assert(saveAllCommand.Validate());
+    budgetWorkspace->Handle(saveAllCommand);
+    assert(!coldEditor->IsModified());
+    assert(!budgetWorkspace->GetCurrentEditor()->IsModified());
+    assert(std::filesystem::file_size("testfile/tempnewdir/coldfile") == 9 * (appendColdCommand.GetArgs()[0].size() + 1));
+    assert(!std::filesystem::exists("testfile/tempnewdir/coldfile.saving"));
+    coldEditor.reset();
+    budgetWorkspace.reset();
+    std::cout << "Passed: save all writes every modified editor in parallel" << std::endl;
+
+    // a save replaces the file a link points to, with the file's permissions
+    std::ofstream("testfile/tempnewdir/linkedfile") << "before\n";
+    std::filesystem::permissions("testfile/tempnewdir/linkedfile", std::filesystem::perms::owner_read
+        | std::filesystem::perms::owner_write | std::filesystem::perms::group_read);
+    std::filesystem::remove("testfile/tempnewdir/link");
+    std::filesystem::create_symlink("linkedfile", "testfile/tempnewdir/link");
+    WriteEditorFile("testfile/tempnewdir/link", {"after"});
+    assert(std::filesystem::is_symlink("testfile/tempnewdir/link"));
+    assert(std::filesystem::status("testfile/tempnewdir/linkedfile").permissions() == (std::filesystem::perms::owner_read
+        | std::filesystem::perms::owner_write | std::filesystem::perms::group_read));
+    assert(std::filesystem::file_size("testfile/tempnewdir/linkedfile") == 6);
+    std::filesystem::remove("testfile/tempnewdir/link");
+    std::filesystem::remove("testfile/tempnewdir/linkedfile");
+    std::cout << "Passed: saving through a link keeps the link and the permissions" << std::endl;
+
+    Ref<Workspace> replaceWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    replaceWorkspace->SetThreadCount(4);
+    for (const std::string name : {"replace_a", "replace_b", "replace_c"}) {
+        replaceWorkspace->Handle(Command("init testfile/tempnewdir/" + name));
+        replaceWorkspace->GetCurrentEditor()->Handle(Command(name == "replace_b" ? "append nothing" : "append \"int a = 1; int b;\""));
+    }
+    auto replaceC = replaceWorkspace->GetCurrentEditor();
+    replaceC->Handle(Command("append \"print(a);\""));
+    std::stringstream replaced;
+    auto* console = std::cout.rdbuf(replaced.rdbuf());
+    Command replaceAllCommand("replace-all \"int (\\w+)\" \"long $1\"");
+    assert(replaceAllCommand.Validate());
+    replaceWorkspace->Handle(replaceAllCommand);
+    std::cout.rdbuf(console);
+    assert(replaced.str().find("Replaced: testfile/tempnewdir/replace_a (2 in 1 line(s))\n") != std::string::npos);
+    assert(replaced.str().find("replace_b") == std::string::npos);
+    assert(replaced.str().find("[replace-all] 4 replacement(s) in 2 of 3 file(s)") != std::string::npos);
+    assert(replaceC->GetLines()[0] == "long a = 1; long b;");
+    assert(replaceC->GetLines()[1] == "print(a);");
+    replaceWorkspace->Handle(Command("edit testfile/tempnewdir/replace_a"));
+    replaceWorkspace->GetCurrentEditor()->Handle(Command("undo"));
+    assert(replaceWorkspace->GetCurrentEditor()->GetLines()[0] == "int a = 1; int b;");
+    std::cout << "Passed: replace all across editors, one undo per editor" << std::endl;
+
+    replaceC.reset();
+    replaceWorkspace.reset(); // no `exit`, the replacements are recovered from the journal
+    replaceWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    replaceWorkspace->Handle(Command("edit testfile/tempnewdir/replace_c"));
+    assert(replaceWorkspace->GetCurrentEditor()->GetLines()[0] == "long a = 1; long b;");
+    replaceWorkspace->Handle(Command("edit testfile/tempnewdir/replace_a"));
+    assert(replaceWorkspace->GetCurrentEditor()->GetLines()[0] == "int a = 1; int b;");
+    replaceWorkspace->Handle(Command("save all"));
+    replaceWorkspace.reset();
+    std::cout << "Passed: replace all is journaled per editor" << std::endl;
+
+    replaceWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    replaceWorkspace->SetThreadCount(1);
+    replaceWorkspace->Handle(Command("load testfile/tempnewdir/replace_a testfile/tempnewdir/replace_b testfile/tempnewdir/replace_c"));
+    replaceWorkspace->Handle(Command("edit testfile/tempnewdir/replace_a"));
+    replaceWorkspace->Handle(Command("mem-budget 1"));
+    std::stringstream budgeted;
+    console = std::cout.rdbuf(budgeted.rdbuf());
+    replaceWorkspace->Handle(Command("replace-all long int"));
+    replaceWorkspace->Handle(Command("mem-budget"));
+    std::cout.rdbuf(console);
+    // one editor at a time is loaded, and evicted again before the next
+    assert(budgeted.str().find("[replace-all] 2 replacement(s) in 1 of 3 file(s)") != std::string::npos);
+    assert(budgeted.str().find("2 editor(s) evicted") != std::string::npos);
+    replaceWorkspace->Handle(Command("edit testfile/tempnewdir/replace_c"));
+    assert(replaceWorkspace->GetCurrentEditor()->GetLines()[0] == "int a = 1; int b;");
+    replaceWorkspace->GetCurrentEditor()->Handle(Command("undo"));
+    replaceWorkspace->Handle(Command("mem-budget off"));
+    replaceWorkspace->Handle(Command("exit"));
+    replaceWorkspace.reset();
+    std::cout << "Passed: replace all keeps to the memory budget" << std::endl;
+
+    Ref<Workspace> searchWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    searchWorkspace->Handle(Command("load testfile/tempnewdir/replace_a testfile/tempnewdir/replace_b testfile/tempnewdir/replace_c"));
+    const auto searched = [&searchWorkspace](const std::string& needle) {
+        std::stringstream out;
+        auto* console = std::cout.rdbuf(out.rdbuf());
+        searchWorkspace->Handle(Command("search \"" + needle + "\""));
+        std::cout.rdbuf(console);
+        return out.str();
+    };
+    assert(searched("a = 1") ==
+        "testfile/tempnewdir/replace_a:1:5: int a = 1; int b;\n"
+        "testfile/tempnewdir/replace_c:1:6: long a = 1; long b;\n"
+        "[search] 2 hit(s) in 2 file(s), 2 line(s) searched\n");
+    assert(searched("print(") == "testfile/tempnewdir/replace_c:2:1: print(a);\n"
+        "[search] 1 hit(s) in 1 file(s), 1 line(s) searched\n");
+    // every edit handler keeps the index up to date, undo makes the next search rebuild it
+    searchWorkspace->Handle(Command("edit testfile/tempnewdir/replace_b"));
+    const auto searchEditor = searchWorkspace->GetCurrentEditor();
+    searchEditor->Handle(Command("append \"first print(x)\""));
+    searchEditor->Handle(Command("insert 1:1 \"print(y)\\n\""));
+    searchEditor->Handle(Command("replace 3:1 5 last"));
+    searchEditor->Handle(Command("delete 1:8 1"));
+    assert(searchEditor->GetLines() == std::vector<std::string>({"print(y", "nothing", "last print(x)"}));
+    assert(searched("print(").find("[search] 3 hit(s) in 2 file(s), 3 line(s) searched") != std::string::npos);
+    assert(searched("first").find("[search] 0 hit(s) in 0 file(s), 0 line(s) searched") != std::string::npos);
+    assert(searched("print(y)").find("[search] 0 hit(s)") != std::string::npos);
+    searchEditor->Handle(Command("undo"));
+    assert(searched("print(y)").find("[search] 1 hit(s) in 1 file(s)") != std::string::npos);
+    searchEditor->Handle(Command("replace-re print show"));
+    assert(searched("show(").find("[search] 2 hit(s) in 1 file(s), 2 line(s) searched") != std::string::npos);
+    assert(searched("print(").find("[search] 1 hit(s) in 1 file(s)") != std::string::npos);
+    searchWorkspace->Handle(Command("save all"));
+    searchWorkspace.reset();
+    std::cout << "Passed: indexed search over editors, kept up to date by edits" << std::endl;
+
+    std::filesystem::create_directories("testfile/tempgrep/sub");
+    std::ofstream("testfile/tempgrep/one") << "no\nneedle here\n";
+    std::ofstream("testfile/tempgrep/sub/two") << "a needle\nand a needle\n";
+    std::ofstream("testfile/tempgrep/binary") << std::string("needle\0", 7);
+    Ref<Workspace> grepWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    std::stringstream grepped;
+    auto* grepConsole = std::cout.rdbuf(grepped.rdbuf());
+    Command grepCommand("grep needle testfile/tempgrep");
+    assert(grepCommand.Validate());
+    grepWorkspace->Handle(grepCommand);
+    grepWorkspace->Handle(Command("load @3"));
+    grepWorkspace->Handle(Command("load @4"));
+    std::cout.rdbuf(grepConsole);
+    assert(grepped.str() ==
+        "@1 testfile/tempgrep/one:2:1: needle here\n"
+        "@2 testfile/tempgrep/sub/two:1:3: a needle\n"
+        "@3 testfile/tempgrep/sub/two:2:7: and a needle\n"
+        "[grep] 3 hit(s) in 2 of 3 file(s), 1 binary file(s) skipped\n"
+        "2:7\n"
+        "and a needle\n"
+        "      ^\n"
+        "[load] Error: No hit @4, the last `grep` had 3\n"
+        "[load] Error: Command not handled in workspace.\n");
+    assert(grepWorkspace->GetCurrentEditor()->GetFilePath() == "testfile/tempgrep/sub/two");
+    grepWorkspace.reset();
+    std::filesystem::remove_all("testfile/tempgrep");
+    std::cout << "Passed: grep a directory and load a hit" << std::endl;
+
+#ifndef _WIN32
+    // a link to a device that never ends is skipped, not read
+    std::filesystem::create_directories("testfile/tempgrep");
+    std::ofstream("testfile/tempgrep/one") << "needle\n";
+    std::filesystem::create_symlink("/dev/zero", "testfile/tempgrep/zero");
+    ThreadPool grepPool(2);
+    const auto specialResult = SearchFiles({"testfile/tempgrep/one", "testfile/tempgrep/zero"}, SubstringSearcher("needle"), grepPool);
+    assert(specialResult.hits.size() == 1 && specialResult.specialFiles == 1 && specialResult.binaryFiles == 0);
+    std::filesystem::remove_all("testfile/tempgrep");
+    std::cout << "Passed: grep skips special files" << std::endl;
+#endif
+
+    std::filesystem::remove("testfile/tempnewdir/journaledfile");
+    std::filesystem::remove("testfile/tempnewdir/coldfile");
+    std::filesystem::remove("testfile/tempnewdir/hotfile");
+    std::filesystem::remove("testfile/tempnewdir/autosavedfile");
+    std::filesystem::remove("testfile/tempnewdir/sessionfile");
+    std::filesystem::remove("testfile/tempnewdir/crashfile");
+    std::filesystem::remove("testfile/tempnewdir/multi_a");
+    std::filesystem::remove("testfile/tempnewdir/multi_b");
+    std::filesystem::remove("testfile/tempnewdir/replace_a");
+    std::filesystem::remove("testfile/tempnewdir/replace_b");
+    std::filesystem::remove("testfile/tempnewdir/replace_c");
+    std::filesystem::remove("testfile/tempnewdir/state.json");
     std::filesystem::remove("testfile/tempnewdir/workspacetempfile");
     std::filesystem::remove("testfile/tempnewdir/.workspacetempfile.log");
     std::filesystem::remove("testfile/.emptyfile.log");
@@ -192,4 +1166,166 @@ void TestWorkspace() {
     std::filesystem::remove("testfile/tempnewdir");
 
     std::cout << "======== End of Workspace Testing ========" << std::endl << std::endl;
-}
\ No newline at end of file
+}
+void TestTreeDrawer() {
+    std::cout << "======== Testing TreeDrawer ========" << std::endl;
+
+    std::filesystem::create_directories("testfile/tempwalk/b");
+    std::filesystem::create_directories("testfile/tempwalk/a/y");
+    std::ofstream("testfile/tempwalk/a/x");
+    std::ofstream("testfile/tempwalk/c");
+
+    const DirNode root = DirWalker(4).Walk("testfile/tempwalk");
+    assert(root.children.size() == 3);
+    assert(root.children[0].name == "a" && root.children[0].isDirectory);
+    assert(root.children[0].children.size() == 2);
+    assert(root.children[0].children[0].name == "x" && !root.children[0].children[0].isDirectory);
+    assert(root.children[0].children[1].name == "y" && root.children[0].children[1].isDirectory);
+    assert(root.children[1].name == "b" && root.children[1].children.empty());
+    assert(root.children[2].name == "c" && !root.children[2].isDirectory);
+    std::cout << "Passed: parallel walk collects a sorted tree" << std::endl;
+
+    std::stringstream drawn;
+    auto* console = std::cout.rdbuf(drawn.rdbuf());
+    DrawDirTree("testfile/tempwalk");
+    std::cout.rdbuf(console);
+    assert(drawn.str() ==
+        "├── a\n"
+        "│   ├── x\n"
+        "│   └── y\n"
+        "├── b\n"
+        "└── c\n");
+    std::cout << "Passed: draw tree" << std::endl;
+
+    assert(MatchGlob("*.cpp", "Editor.cpp") && !MatchGlob("*.cpp", "Editor.h"));
+    assert(MatchGlob("a?c", "abc") && !MatchGlob("a?c", "ac"));
+    assert(MatchGlob("[a-c]*", "build") && !MatchGlob("[!a-c]*", "build"));
+    assert(MatchGlob("*", "") && MatchGlob("a*b*c", "axxbyyc") && !MatchGlob("a*b*c", "axxbyy"));
+    std::cout << "Passed: glob matching" << std::endl;
+
+    DirWalkOptions walkOptions;
+    walkOptions.maxDepth = 1;
+    walkOptions.exclude = {"b"};
+    const DirNode pruned = DirWalker(2).Walk("testfile/tempwalk", walkOptions);
+    assert(pruned.children.size() == 2 && pruned.children[0].name == "a" && pruned.children[1].name == "c");
+    assert(pruned.children[0].children.empty());
+    std::cout << "Passed: walk prunes by depth and exclude" << std::endl;
+
+    DirTreeOptions drawOptions;
+    drawOptions.include = {"y", "c"};
+    drawn.str("");
+    console = std::cout.rdbuf(drawn.rdbuf());
+    DrawDirTree(root, drawOptions);
+    std::cout.rdbuf(console);
+    assert(drawn.str() ==
+        "├── a\n"
+        "│   └── y\n"
+        "├── b\n"
+        "└── c\n");
+    drawOptions.include.clear();
+    drawOptions.maxEntries = 2;
+    drawn.str("");
+    console = std::cout.rdbuf(drawn.rdbuf());
+    DrawDirTree(root, drawOptions);
+    std::cout.rdbuf(console);
+    assert(drawn.str() ==
+        "├── a\n"
+        "│   ├── x\n"
+        "... stopped after 2 entries\n");
+    std::cout << "Passed: draw tree with include and max entries" << std::endl;
+
+    Ref<Workspace> treeWorkspace = CreateRef<Workspace>("", s_TestJournalPath);
+    drawn.str("");
+    console = std::cout.rdbuf(drawn.rdbuf());
+    treeWorkspace->Handle(Command("dir-tree testfile/tempwalk --depth 1 --exclude c"));
+    std::cout.rdbuf(console);
+    assert(drawn.str() ==
+        "testfile/tempwalk\n"
+        "├── a\n"
+        "└── b\n");
+    // rejected before anything is drawn
+    drawn.str("");
+    console = std::cout.rdbuf(drawn.rdbuf());
+    treeWorkspace->Handle(Command("dir-tree testfile/tempwalk --depth"));
+    treeWorkspace->Handle(Command("dir-tree testfile/tempwalk --depth 0"));
+    treeWorkspace->Handle(Command("dir-tree testfile/tempwalk --sort"));
+    std::cout.rdbuf(console);
+    assert(drawn.str().find("├──") == std::string::npos);
+    std::cout << "Passed: dir-tree options" << std::endl;
+
+    std::ofstream("testfile/tempwalk/a/x") << std::string(3000, 'x');
+    std::ofstream("testfile/tempwalk/c") << "hello";
+    walkOptions = DirWalkOptions();
+    walkOptions.readSizes = true;
+    const DirNode sized = DirWalker(2).Walk("testfile/tempwalk", walkOptions);
+    assert(sized.children[0].children[0].size == 3000 && sized.children[2].size == 5);
+    drawOptions = DirTreeOptions();
+    drawOptions.summary = true;
+    drawn.str("");
+    console = std::cout.rdbuf(drawn.rdbuf());
+    DrawDirTree(sized, drawOptions);
+    std::cout.rdbuf(console);
+    assert(drawn.str() ==
+        "├── a  (1 file, 2.9 KiB)\n"
+        "│   ├── x  (2.9 KiB)\n"
+        "│   └── y  (0 files, 0 B)\n"
+        "├── b  (0 files, 0 B)\n"
+        "└── c  (5 B)\n"
+        "Total: 2 files, 2.9 KiB\n"
+        "Largest files:\n"
+        "    2.9 KiB  a/x\n"
+        "    5 B  c\n");
+    {
+        DirTreeCache cache(2);
+        assert(cache.Get("testfile/tempwalk", true).children[2].size == 5);
+        std::ofstream("testfile/tempwalk/c", std::ios::app) << " world";
+        assert(cache.Get("testfile/tempwalk", true).children[2].size == 11);
+        assert(cache.GetStats().fullWalks == 1);
+    }
+    std::ofstream("testfile/tempwalk/a/x").close();
+    std::ofstream("testfile/tempwalk/c").close();
+    std::cout << "Passed: dir-tree summary" << std::endl;
+
+    for (const bool useInotify : {true, false}) {
+        DirTreeCache cache(2, useInotify);
+        cache.Get("testfile/tempwalk");
+        assert(cache.Get("testfile/tempwalk").children.size() == 3);
+        assert(cache.GetStats().fullWalks == 1 && cache.GetStats().refreshedDirectories == 0);
+        // directory mtimes may only move on the next clock tick
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::ofstream("testfile/tempwalk/a/z");
+        std::filesystem::remove_all("testfile/tempwalk/b");
+        const auto& tree = cache.Get("testfile/tempwalk");
+        assert(cache.GetStats().fullWalks == 1 && cache.GetStats().refreshedDirectories == 2);
+        assert(tree.children.size() == 2);
+        assert(tree.children[0].children.size() == 3 && tree.children[0].children[2].name == "z");
+        assert(tree.children[1].name == "c");
+        assert(cache.IsPolling("testfile/tempwalk") == !useInotify);
+        std::filesystem::create_directories("testfile/tempwalk/b");
+        std::filesystem::remove("testfile/tempwalk/a/z");
+    }
+    std::cout << "Passed: cached tree refreshes only changed directories" << std::endl;
+
+    for (const bool useInotify : {true, false}) {
+        DirTreeCache cache(2, useInotify);
+        cache.Get("testfile/tempwalk");
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::filesystem::remove_all("testfile/tempwalk/a");
+        std::filesystem::create_directories("testfile/tempwalk/a");
+        std::ofstream("testfile/tempwalk/a/new");
+        assert(cache.Get("testfile/tempwalk").children[0].children.size() == 1);
+        // the directory made again is followed like the one it replaced
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::ofstream("testfile/tempwalk/a/later");
+        const auto& recreated = cache.Get("testfile/tempwalk").children[0];
+        assert(recreated.children.size() == 2 && recreated.children[0].name == "later");
+        std::filesystem::remove_all("testfile/tempwalk/a");
+        std::filesystem::create_directories("testfile/tempwalk/a/y");
+        std::ofstream("testfile/tempwalk/a/x");
+    }
+    std::cout << "Passed: cached tree follows directories made again under the same name" << std::endl;
+
+    std::filesystem::remove_all("testfile/tempwalk");
+
+    std::cout << "======== End of TreeDrawer Testing ========" << std::endl << std::endl;
+}